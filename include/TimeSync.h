@@ -0,0 +1,10 @@
+#include <Arduino.h>
+
+#pragma once
+
+// Quality of the system time, shown on the display
+//   NONE      the time is unknown
+//   RESTORED  restored after a soft reboot, not yet synchronized
+//   SYNCED    synchronized with the NTP server within the last 2 hours
+//   STALE     the last synchronization is older than 2 hours
+enum class TimeSync : uint8_t { NONE, RESTORED, SYNCED, STALE };
@@ -78,7 +78,7 @@ public:
       cfg.bus_shared = false;  // set to true if using a common bus with the screen
       cfg.offset_rotation = 1; // adjust if display and touch orientation do not match, (set 1 for LANDSCAPE, 3 for PORTRAIT)
       // For SPI connection
-      cfg.spi_host = VSPI_HOST;  // Select SPI to use (HSPI_HOST or VSPI_HOST)
+      cfg.spi_host = -1;         // Software SPI, VSPI_HOST is left to the SD card (HSPI_HOST or VSPI_HOST or -1)
       cfg.freq = 1000000;        // Set SPI clock
       cfg.pin_sclk = TP_SCLK;    // pin number where SCLK is connected, TP CLK
       cfg.pin_mosi = TP_MOSI;    // pin number where MOSI is connected, TP DIN
@@ -0,0 +1,103 @@
+#include "AdcSampler.h"
+
+
+/**
+ * Adds an analog input to be sampled. Must be called before begin().
+ * Returns the channel number or -1 if all channels are in use.
+ */
+int AdcSampler::addChannel(uint8_t pin, uint8_t oversampling, uint8_t smoothing)
+{
+    if (_count >= MAX_CHANNELS) return -1;
+    pinMode(pin, INPUT);
+    _channels[_count] = { pin, static_cast<uint8_t>(max(oversampling, static_cast<uint8_t>(1))), smoothing, 0, 0 };
+    return _count++;
+}
+
+/**
+ * Starts the sampler task. It samples every msPeriod milliseconds
+ * and publishes a snapshot every decimation periods.
+ */
+bool AdcSampler::begin(uint32_t msPeriod, uint16_t decimation, UBaseType_t priority, BaseType_t core)
+{
+    _msPeriod = max(msPeriod, static_cast<uint32_t>(1));
+    _decimation = max(decimation, static_cast<uint16_t>(1));
+    return xTaskCreatePinnedToCore(samplerTask, "adcSampler", 2048, this, priority, nullptr, core) == pdPASS;
+}
+
+void AdcSampler::samplerTask(void *arg)
+{
+    AdcSampler *sampler = static_cast<AdcSampler *>(arg);
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;)
+    {
+        sampler->sample();
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(sampler->_msPeriod));
+    }
+}
+
+// Reads a burst of conversions per channel. After decimation 
+// periods the averages are filtered and published.
+void AdcSampler::sample()
+{
+    for (int i = 0; i < _count; i++)
+    {
+        Channel &ch = _channels[i];
+        for (int n = 0; n < ch.oversampling; n++) ch.sum += analogRead(ch.pin);
+    }
+    if (++_periods < _decimation) return;
+    _periods = 0;
+
+    _seq.store(_seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < _count; i++)
+    {
+        Channel &ch = _channels[i];
+        uint32_t avg = ch.sum / (static_cast<uint32_t>(ch.oversampling) * _decimation);
+        ch.sum = 0;
+        int32_t target = static_cast<int32_t>(avg) << 4;
+        ch.filtered = _isFirst ? target : ch.filtered + ((target - ch.filtered) >> ch.smoothing);
+        _snapshot.average[i] = avg;
+        _snapshot.value[i] = (ch.filtered + 8) >> 4;
+    }
+    _snapshot.sequence++;
+    _isFirst = false;
+    _seq.store(_seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+/**
+ * Copies the latest consistent snapshot of all channels into s
+ */
+void AdcSampler::snapshot(AdcSnapshot &s) const
+{
+    uint32_t seq;
+    do
+    {
+        seq = _seq.load(std::memory_order_acquire);
+        if (seq & 1) continue;  // being written
+        s = _snapshot;
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != _seq.load(std::memory_order_relaxed));
+}
+
+// Filtered value of channel ch
+uint16_t AdcSampler::value(int ch) const
+{
+    AdcSnapshot s;
+    snapshot(s);
+    return (ch >= 0 && ch < _count) ? s.value[ch] : 0;
+}
+
+// Average of channel ch over the last decimation periods
+uint16_t AdcSampler::average(int ch) const
+{
+    AdcSnapshot s;
+    snapshot(s);
+    return (ch >= 0 && ch < _count) ? s.average[ch] : 0;
+}
+
+// Number of snapshots published so far
+uint32_t AdcSampler::sequence() const
+{
+    return _seq.load(std::memory_order_acquire) / 2;
+}
+// --- AdcSampler ---
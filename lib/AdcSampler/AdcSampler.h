@@ -0,0 +1,72 @@
+#include <Arduino.h>
+#include <atomic>
+
+#pragma once
+
+/**
+ * Class        AdcSampler
+ * 
+ * Purpose      Samples analog inputs continuously in a task of its own.
+ *              Each period every channel is read in a burst of oversampling
+ *              conversions. The sums of decimation periods are averaged and
+ *              smoothed by an exponential filter. The averages and filtered 
+ *              values of all channels are then published as one snapshot.
+ *              Consumers read the latest snapshot in constant time without
+ *              touching the ADC and without locking. The snapshot is guarded 
+ *              by a sequence counter: the sampler makes it odd while writing,
+ *              a reader copies the values and retries if the counter was odd 
+ *              or has changed meanwhile.
+ * 
+ * Usage        AdcSampler adcSampler;
+ *              int ldr = adcSampler.addChannel(CDS_LDR);
+ *              adcSampler.begin();                // sample every 10 ms, publish every 250 ms
+ *              uint16_t v = adcSampler.value(ldr); // filtered value 0..4095
+ * 
+ * Remarks      The timed sampler task is used instead of the continuous 
+ *              (DMA) mode of the ADC, which the Arduino core 2.x does not
+ *              offer. At some 100 conversions per period the load is small.
+ */
+struct AdcSnapshot
+{
+    static const uint8_t MAX_CHANNELS = 4;
+
+    uint16_t value[MAX_CHANNELS] = {};    // filtered
+    uint16_t average[MAX_CHANNELS] = {};  // average of the last decimation periods
+    uint32_t sequence = 0;                // number of snapshots published
+};
+
+
+class AdcSampler
+{
+    public:
+        static const uint8_t MAX_CHANNELS = AdcSnapshot::MAX_CHANNELS;
+
+        int  addChannel(uint8_t pin, uint8_t oversampling=8, uint8_t smoothing=2);
+        bool begin(uint32_t msPeriod=10, uint16_t decimation=25, UBaseType_t priority=1, BaseType_t core=0);
+        void snapshot(AdcSnapshot &s) const;
+        uint16_t value(int ch) const;
+        uint16_t average(int ch) const;
+        uint32_t sequence() const;
+
+    private:
+        struct Channel
+        {
+            uint8_t  pin;
+            uint8_t  oversampling;  // conversions per period
+            uint8_t  smoothing;     // the filter moves by 1/2^smoothing of the deviation
+            uint32_t sum;
+            int32_t  filtered;      // 1/16 LSB
+        };
+
+        static void samplerTask(void *arg);
+        void sample();
+
+        Channel  _channels[MAX_CHANNELS];
+        uint8_t  _count = 0;
+        uint32_t _msPeriod = 10;
+        uint16_t _decimation = 25;
+        uint16_t _periods = 0;
+        bool     _isFirst = true;
+        AdcSnapshot _snapshot;
+        std::atomic<uint32_t> _seq{0};  // odd while the snapshot is written
+};
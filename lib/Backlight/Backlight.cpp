@@ -0,0 +1,93 @@
+#include "Backlight.h"
+
+// Bright light reads about 0, darkness up to 4095
+static const BacklightPoint defaultCurve[] = { {0, 255}, {300, 200}, {1000, 96}, {2500, 32}, {4095, 16} };
+
+
+Backlight::Backlight()
+{
+    setCurve(defaultCurve, sizeof(defaultCurve) / sizeof(defaultCurve[0]));
+}
+
+/**
+ * Sets the curve from ambient light to brightness. The points
+ * must be sorted by ascending ambient reading, at most MAX_POINTS.
+ */
+void Backlight::setCurve(const BacklightPoint *points, uint8_t count)
+{
+    _count = min(count, MAX_POINTS);
+    for (int i = 0; i < _count; i++) _curve[i] = points[i];
+}
+
+void Backlight::setHysteresis(uint8_t hysteresis)
+{
+    _hysteresis = hysteresis;
+}
+
+void Backlight::setSlew(uint8_t slew)
+{
+    _slew = max(slew, static_cast<uint8_t>(1));
+}
+
+// The brightness follows the ambient light
+void Backlight::setAuto()
+{
+    _isAuto = true;
+}
+
+// The brightness is fixed, the ambient light is ignored
+void Backlight::setManual(uint8_t brightness)
+{
+    _isAuto = false;
+    _target = brightness;
+}
+
+bool Backlight::isAuto()
+{
+    return _isAuto;
+}
+
+uint8_t Backlight::brightness()
+{
+    return _brightness;
+}
+
+/**
+ * Computes the brightness for the ambient reading. Returns true 
+ * and the brightness if it has changed since the last update.
+ */
+bool Backlight::update(uint16_t ambient, uint8_t &brightness)
+{
+    if (_isAuto)
+    {
+        uint8_t target = fromCurve(ambient);
+        if (abs(target - _target) >= _hysteresis) _target = target;
+    }
+    if (_brightness == _target) return false;
+
+    int delta = _target - _brightness;
+    if (delta > _slew) delta = _slew;
+    if (delta < -_slew) delta = -_slew;
+    _brightness += delta;
+    brightness = _brightness;
+    return true;
+}
+
+// Interpolates the brightness between the points of the curve
+uint8_t Backlight::fromCurve(uint16_t ambient)
+{
+    if (_count == 0) return 255;
+    if (ambient <= _curve[0].ambient) return _curve[0].brightness;
+    for (int i = 1; i < _count; i++)
+    {
+        const BacklightPoint &p0 = _curve[i-1];
+        const BacklightPoint &p1 = _curve[i];
+        if (ambient <= p1.ambient)
+        {
+            return p0.brightness + (static_cast<int32_t>(p1.brightness) - p0.brightness) 
+                                 * (ambient - p0.ambient) / (p1.ambient - p0.ambient);
+        }
+    }
+    return _curve[_count-1].brightness;
+}
+// --- Backlight ---
@@ -0,0 +1,60 @@
+#include <Arduino.h>
+
+#pragma once
+
+/**
+ * Class        Backlight
+ * 
+ * Purpose      Controls the brightness of the backlight from the ambient 
+ *              light measured by the LDR. The filtered LDR reading is mapped
+ *              by a piecewise linear curve to a target brightness. The target
+ *              only follows changes larger than the hysteresis, so a reading
+ *              near a step does not make the backlight flicker. The brightness
+ *              approaches the target by at most slew steps per update.
+ *              In manual mode a fixed brightness overrides the curve.
+ * 
+ * Usage        Backlight backlight;
+ *              Wait waitBacklight(50);
+ *              void loop() 
+ *              { 
+ *                  uint8_t b;
+ *                  if (waitBacklight.isOver() && backlight.update(adcSampler.value(ldr), b)) 
+ *                      lcd.setBrightness(b);
+ *              }
+ * 
+ * Remarks      The LDR of the CYD reads low values in bright light and high
+ *              values in the dark, so the default curve falls with the reading.
+ */
+struct BacklightPoint
+{
+    uint16_t ambient;     // LDR reading
+    uint8_t  brightness;  // backlight PWM 0..255
+};
+
+
+class Backlight
+{
+    public:
+        static const uint8_t MAX_POINTS = 8;
+
+        Backlight();
+        void setCurve(const BacklightPoint *points, uint8_t count);
+        void setHysteresis(uint8_t hysteresis);
+        void setSlew(uint8_t slew);
+        void setAuto();
+        void setManual(uint8_t brightness);
+        bool isAuto();
+        uint8_t brightness();
+        bool update(uint16_t ambient, uint8_t &brightness);
+
+    private:
+        uint8_t fromCurve(uint16_t ambient);
+
+        BacklightPoint _curve[MAX_POINTS];
+        uint8_t _count = 0;
+        uint8_t _hysteresis = 8;   // brightness steps the curve must move to change the target
+        uint8_t _slew = 4;         // max brightness steps per update
+        bool    _isAuto = true;
+        uint8_t _target = 255;
+        uint8_t _brightness = 255;
+};
@@ -0,0 +1,285 @@
+#include "DataLogger.h"
+
+static const char LOG_MAGIC[8] = "CYDLOG1";
+static const uint16_t LOG_VERSION = 1;
+static_assert(sizeof(LogRecord) == 16, "records must fill the sectors");
+static_assert(sizeof(LogHeader) == 512, "the header is one sector");
+
+// The tag of the records of a segment, never 0 like a preallocated area
+static uint16_t tagOf(uint32_t sequence)
+{
+    return sequence % 0xffff + 1;
+}
+
+// Reads the record at position i of a segment file
+static bool readRecord(File &f, uint32_t i, LogRecord &r)
+{
+    return f.seek(sizeof(LogHeader) + i * sizeof(LogRecord)) && f.read(reinterpret_cast<uint8_t *>(&r), sizeof(r)) == sizeof(r);
+}
+
+
+/**
+ * Finds the latest segment on the card and continues it if it was
+ * still being written at the reset, otherwise starts the next one.
+ * The records are flushed by a background task. Returns false 
+ * if the segment cannot be created, e.g. without SD card.
+ */
+bool DataLogger::begin(uint8_t segments, uint32_t segmentSize)
+{
+    if (_mutex != nullptr) return _isOpen;
+    _mutex = xSemaphoreCreateMutex();
+    _segments = min(max(segments, static_cast<uint8_t>(2)), MAX_SEGMENTS);
+    _capacity = (segmentSize - sizeof(LogHeader)) / sizeof(LogRecord);
+    if (! _writer.begin(true)) return false;
+
+    LogHeader latest;
+    bool isFound = false;
+    {
+        SpiLock lock(_bus);
+        if (! lock) return false;
+        SD.mkdir(_dir);
+        for (int i = 0; i < _segments; i++)
+        {
+            char path[32];
+            segmentPath(i, path, sizeof(path));
+            File f = SD.open(path, FILE_READ);
+            LogHeader h;
+            if (f && f.read(reinterpret_cast<uint8_t *>(&h), sizeof(h)) == sizeof(h) && memcmp(h.magic, LOG_MAGIC, sizeof(LOG_MAGIC)) == 0)
+            {
+                if (! isFound || h.sequence > latest.sequence) latest = h;
+                isFound = true;
+            }
+            if (f) f.close();
+        }
+    }
+    if (isFound && latest.count == LogHeader::OPEN && resumeSegment(latest))
+    {
+        _isOpen = true;
+        log_i("==> Logging to segment %lu after record %lu", _header.sequence, _count);
+        return true;
+    }
+    _header.sequence = isFound ? latest.sequence + 1 : 0;
+    _isOpen = startSegment();
+    log_i("==> Logging to segment %lu", _header.sequence);
+    return _isOpen;
+}
+
+/**
+ * Appends a record, may be called from any task. The record is only
+ * copied to the buffer, the background task writes full buffers.
+ * While a full segment is replaced by the rotate task, the records
+ * are kept in a small list and appended to the new segment.
+ */
+bool DataLogger::log(uint8_t source, uint8_t event, float value)
+{
+    LogRecord r;
+    time_t now = time(nullptr);
+    r.epoch  = now > 1700000000 ? static_cast<uint32_t>(now) : 0;
+    r.uptime = millis();
+    r.value  = value;
+    r.source = source;
+    r.event  = event;
+
+    if (_mutex == nullptr)      // begin() was not called, e.g. without SD card
+    {
+        _dropped++;
+        return false;
+    }
+    bool isKept = false;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    if (_isRotating)
+    {
+        isKept = (_waitingCount < MAX_WAITING);
+        if (isKept) _waiting[_waitingCount++] = r;
+    }
+    else if (_isOpen)
+    {
+        isKept = append(r);
+    }
+    if (! isKept) _dropped++;
+    xSemaphoreGive(_mutex);
+    return isKept;
+}
+
+// Writes the buffered records to the card, at most the current sector is lost at a power failure
+bool DataLogger::flush()
+{
+    if (_mutex == nullptr) return false;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    bool isOk = _isRotating || (_isOpen && _writer.flush());  // a rotation flushes anyway
+    xSemaphoreGive(_mutex);
+    return isOk;
+}
+
+// Completes the header of the current segment, e.g. before the card is removed
+void DataLogger::close()
+{
+    if (_mutex == nullptr) return;
+    while (_isRotating) delay(10);
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    if (_isOpen) finishSegment();
+    _isOpen = false;
+    xSemaphoreGive(_mutex);
+}
+
+// Number of the current segment since the log was created
+uint32_t DataLogger::sequence() const
+{
+    return _header.sequence;
+}
+
+// Records in the current segment
+uint32_t DataLogger::count() const
+{
+    return _count;
+}
+
+uint32_t DataLogger::dropped() const
+{
+    return _dropped;
+}
+
+/**
+ * Appends a record to the current segment, called with the mutex taken.
+ * A full segment is closed and the oldest one reopened by the rotate task.
+ */
+bool DataLogger::append(LogRecord &r)
+{
+    r.tag = tagOf(_header.sequence);
+    if (_count == 0) _header.firstEpoch = r.epoch;
+    if (_nextSlot < LogHeader::INDEX_SIZE && _count >= slotRecord(_nextSlot))
+    {
+        _header.index[_nextSlot++] = r.epoch;   // first record of the next 1/INDEX_SIZE
+    }
+    _header.lastEpoch = r.epoch;
+    bool isWritten = (_writer.write(reinterpret_cast<const uint8_t *>(&r), sizeof(r)) == sizeof(r));
+    if (isWritten) _count++;
+    if (_count >= _capacity)   // the segment is full, continue with the oldest
+    {
+        _isRotating = true;
+        _waitingCount = 0;
+        if (xTaskCreate(rotateTask, "logRotate", 4096, this, 1, nullptr) != pdPASS) rotate();
+    }
+    return isWritten;
+}
+
+/**
+ * Completes the full segment and starts the next one. The segment
+ * and the header are only used by log() again when _isRotating is
+ * cleared, so the card is written without the mutex.
+ */
+void DataLogger::rotate()
+{
+    finishSegment();
+    _header.sequence++;
+    bool isOpen = startSegment();
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _isOpen = isOpen;
+    _isRotating = false;
+    uint8_t waitingCount = _waitingCount;
+    _waitingCount = 0;
+    for (uint8_t i = 0; i < waitingCount; i++)
+    {
+        if (_isRotating || ! _isOpen || ! append(_waiting[i])) _dropped++;
+    }
+    xSemaphoreGive(_mutex);
+}
+
+void DataLogger::rotateTask(void *arg)
+{
+    static_cast<DataLogger *>(arg)->rotate();
+    vTaskDelete(nullptr);
+}
+
+// Opens the segment file of the current sequence, preallocated to its full size
+bool DataLogger::startSegment()
+{
+    char path[32];
+    segmentPath(_header.sequence % _segments, path, sizeof(path));
+    uint32_t sequence = _header.sequence;
+    memset(&_header, 0, sizeof(_header));
+    memcpy(_header.magic, LOG_MAGIC, sizeof(LOG_MAGIC));
+    _header.version = LOG_VERSION;
+    _header.recordSize = sizeof(LogRecord);
+    _header.sequence = sequence;
+    _header.capacity = _capacity;
+    _header.count = LogHeader::OPEN;
+    _count = 0;
+    _nextSlot = 0;
+    if (! _writer.open(path, sizeof(LogHeader) + _capacity * sizeof(LogRecord))) return false;
+    _writer.write(reinterpret_cast<const uint8_t *>(&_header), sizeof(_header));
+    return true;
+}
+
+/**
+ * Continues the segment h after its last valid record. The valid
+ * records are a prefix of the segment, so the first record without
+ * the tag is found by a binary search. The epochs of the header are
+ * read back from the records. Returns false if the segment cannot 
+ * be continued; a full segment is completed.
+ */
+bool DataLogger::resumeSegment(const LogHeader &h)
+{
+    if (h.capacity != _capacity || h.recordSize != sizeof(LogRecord)) return false;
+    char path[32];
+    segmentPath(h.sequence % _segments, path, sizeof(path));
+    uint16_t tag = tagOf(h.sequence);
+    _header = h;
+    {
+        SpiLock lock(_bus);
+        if (! lock) return false;
+        File f = SD.open(path, FILE_READ);
+        if (! f) return false;
+        uint32_t lo = 0;
+        uint32_t hi = _capacity;
+        LogRecord r;
+        while (lo < hi)
+        {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (readRecord(f, mid, r) && r.tag == tag) lo = mid + 1;
+            else hi = mid;
+        }
+        _count = lo;
+        _nextSlot = 0;
+        while (_nextSlot < LogHeader::INDEX_SIZE && slotRecord(_nextSlot) < _count && readRecord(f, slotRecord(_nextSlot), r))
+        {
+            _header.index[_nextSlot++] = r.epoch;
+        }
+        if (_count > 0 && readRecord(f, 0, r)) _header.firstEpoch = r.epoch;
+        if (_count > 0 && readRecord(f, _count - 1, r)) _header.lastEpoch = r.epoch;
+        f.close();
+    }
+    if (_count >= _capacity)    // full, but not completed before the reset
+    {
+        finishSegment();
+        return false;
+    }
+    return _writer.open(path, 0, "r+") && _writer.seek(sizeof(LogHeader) + _count * sizeof(LogRecord));
+}
+
+// Closes the segment and rewrites its header with the count and the index
+void DataLogger::finishSegment()
+{
+    _writer.close();
+    _header.count = _count;
+    char path[32];
+    segmentPath(_header.sequence % _segments, path, sizeof(path));
+    SpiLock lock(_bus);
+    if (! lock) return;
+    File f = SD.open(path, "r+");
+    if (! f) return;
+    f.write(reinterpret_cast<const uint8_t *>(&_header), sizeof(_header));
+    f.close();
+}
+
+// Position of the record whose epoch is kept in the given slot of the index
+uint32_t DataLogger::slotRecord(uint8_t slot) const
+{
+    return (static_cast<uint64_t>(slot) * _capacity + LogHeader::INDEX_SIZE - 1) / LogHeader::INDEX_SIZE;
+}
+
+void DataLogger::segmentPath(uint32_t segment, char *buf, size_t size) const
+{
+    snprintf(buf, size, "%s/seg%02lu.bin", _dir, static_cast<unsigned long>(segment));
+}
+// --- DataLogger ---
@@ -0,0 +1,108 @@
+#include <Arduino.h>
+#include <SD.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <atomic>
+#include "SdWriter.h"
+#include "SpiBus.h"
+
+#pragma once
+
+// A record of 16 bytes, 32 fit into a sector
+struct LogRecord
+{
+    uint32_t epoch;    // UTC seconds, 0 while the time is unknown
+    uint32_t uptime;   // ms since boot
+    float    value;
+    uint8_t  source;   // e.g. LDR, backlight, WiFi, defined by the application
+    uint8_t  event;    // meaning of the value, defined by the source
+    uint16_t tag;      // segment sequence % 0xffff + 1, marks the valid records
+};
+
+// The first sector of a segment file
+struct LogHeader
+{
+    static const uint8_t INDEX_SIZE = 64;
+    static const uint32_t OPEN = 0xffffffff;
+
+    char     magic[8];     // "CYDLOG1"
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t sequence;     // number of the segment since the log was created
+    uint32_t capacity;     // records
+    uint32_t count;        // records written, OPEN while the segment is written
+    uint32_t firstEpoch;
+    uint32_t lastEpoch;
+    uint32_t index[INDEX_SIZE];  // epoch of the first record of each 1/INDEX_SIZE of the segment
+    uint8_t  reserved[512 - 32 - 4*INDEX_SIZE];
+};
+
+
+/**
+ * Class        DataLogger
+ * 
+ * Purpose      Logs fixed-size binary records to the SD card for months of
+ *              unattended operation. The log is a ring of preallocated 
+ *              segment files /LOG/seg00.bin ... Each segment starts with a
+ *              header sector followed by the records. When a segment is
+ *              full, its header is completed with the number of records 
+ *              and an index of the times, and the oldest segment is reused.
+ *              The records go through an SdWriter with 2 buffers and a 
+ *              background task, so log() only copies 16 bytes. A full
+ *              segment is replaced by a task of its own, meanwhile up to
+ *              MAX_WAITING records are kept in RAM.
+ * 
+ * Usage        DataLogger logger(sdBus);
+ *              logger.begin();                       // after initSDCard()
+ *              logger.log(LOG_LDR, 0, ldrValue);     // from any task
+ *              logger.flush();                       // now and then, e.g. every minute
+ * 
+ * Remarks      A segment that was being written when the power failed has
+ *              count OPEN. Its valid records carry the tag of its sequence,
+ *              the preallocated rest does not.
+ *              At boot such a segment is continued after its last valid
+ *              record, so a reboot does not cost a segment.
+ */
+class DataLogger
+{
+    public:
+        static const uint8_t  MAX_SEGMENTS = 64;
+        static const uint8_t  MAX_WAITING = 32;   // records kept while the segment is replaced
+
+        DataLogger(SpiBus &bus, const char *dir="/LOG") :
+            _bus(bus), _dir(dir), _writer(bus)
+        {}
+
+        bool begin(uint8_t segments=32, uint32_t segmentSize=1 << 20);
+        bool log(uint8_t source, uint8_t event, float value);
+        bool flush();
+        void close();
+        uint32_t sequence() const;
+        uint32_t count() const;
+        uint32_t dropped() const;
+
+    private:
+        bool   append(LogRecord &r);
+        void   rotate();
+        static void rotateTask(void *arg);
+        bool   startSegment();
+        bool   resumeSegment(const LogHeader &h);
+        void   finishSegment();
+        uint32_t slotRecord(uint8_t slot) const;
+        void   segmentPath(uint32_t segment, char *buf, size_t size) const;
+
+        SpiBus    &_bus;
+        const char *_dir;
+        SdWriter   _writer;
+        SemaphoreHandle_t _mutex = nullptr;
+        uint8_t    _segments = 0;
+        uint32_t   _capacity = 0;    // records per segment
+        LogHeader  _header;          // of the current segment
+        uint32_t   _count = 0;       // records in the current segment
+        uint8_t    _nextSlot = 0;    // next entry of the index
+        std::atomic<uint32_t> _dropped{0};      // records lost, e.g. without card
+        std::atomic<bool>     _isOpen{false};
+        std::atomic<bool>     _isRotating{false}; // the rotate task replaces the full segment
+        LogRecord  _waiting[MAX_WAITING];         // records logged meanwhile
+        uint8_t    _waitingCount = 0;
+};
@@ -7,9 +7,10 @@
  *              Starts up an access point AutoConnectAP when no WLAN connection 
  *              could be established and asks the user for WLAN credentials.
  * 
- * Usage        ESP32AutoConnect ac(server, prefs, esp-remote);
+ * Usage        ESP32AutoConnect ac(server, esp-remote);
  *              ac.clearCredentials;  // for test
- *              ac.autoconnect();
+ *              ac.autoconnect();     // returns at once
+ *              void loop() { ac.loop(); }
  * 
  *              - Connect your cell phone to AutoConnectAP
  *              - Open 192.168.4.1 in your browser and enter the WLAN credentials
@@ -18,6 +19,19 @@
  *              - The next time you start the program, your login details are 
  *                known and do not need to be entered again
  * 
+ *              The connection is made without blocking. A state machine driven
+ *              by the WiFi events and by loop() connects with the stored 
+ *              credentials. A failed attempt is repeated after a wait that
+ *              doubles each time. If the first MAX_ATTEMPTS attempts fail, the
+ *              access point is started. A lost connection is always retried.
+ *              The callback set with onStateChange() is called from loop().
+ * 
+ *              The BSSID, the channel and the IP configuration of a successful
+ *              connection are stored. The next connection is first tried 
+ *              directly with this access point on this channel, which saves
+ *              the scan, and optionally with the stored IP configuration, which
+ *              saves DHCP. If it fails, the normal connection follows at once.
+ * 
  * Board        ESP32 DoIt DevKit V1
  * Remarks
  * 
@@ -26,22 +40,24 @@
  *              https://github.com/aliffathoni/ESPAutoWifi             
  */
 #include "ESP32AutoConnect.h"
-#include "query.h"
-
-const bool RW_MODE = false;
-const bool RO_MODE = true;
-
+#include "PortalPage.h"
+#include <memory>
 
 /**
  * Looks for stored credentials and returns true
- * if both ssid and password are found
+ * if both ssid and password are found. Loads also
+ * the link of the last successful connection.
+ * The credentials are read from RAM, see Settings.
  */
 bool ESP32AutoConnect::credentialsAreAvailable()
 {
-    _prefs.begin("credentials", RO_MODE);
-    _ssid = _prefs.getString("ssid", "");
-    _password = _prefs.getString("password", "");
-    _prefs.end();
+    char buf[Setting::MAX_SIZE];
+    _credentials.getText("ssid", buf, sizeof(buf));
+    _ssid = buf;
+    _credentials.getText("password", buf, sizeof(buf));
+    _password = buf;
+    memset(&_link, 0, sizeof(_link));
+    _hasLink = (_credentials.getBytes("link", &_link, sizeof(_link)) == sizeof(_link) && _link.channel != 0);
     return (_ssid != "" && _password != "") ? true : false;    
 }
 
@@ -51,86 +67,91 @@ bool ESP32AutoConnect::credentialsAreAvailable()
  */
 void ESP32AutoConnect::clearCredentials()
 {
-  _prefs.begin("credentials", RW_MODE);
-  _prefs.clear();
-  _prefs.end();
+  _credentials.clear();
+  _credentials.commit();
 }
 
 
 /**
- * Returns true if th ESP is connected to the network stored in preferences
+ * Use the IP configuration of the last connection instead of DHCP.
+ * Only use it if the router reserves the address for this device.
  */
-bool ESP32AutoConnect::weAreConnectedToWLAN(String ssid, String password) 
-{  
-  WiFi.setHostname(_hostname.c_str()); // set hostname first
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid, password);
-  return (WiFi.waitForConnectResult() != WL_CONNECTED) ? false : true;
+void ESP32AutoConnect::useCachedIP(bool enable)
+{
+  _useCachedIP = enable;
 }
 
 
 /**
- * Look for available networks and compose the 
- * option list for the query web page
+ * Stores the link of the current connection, unless it is 
+ * the same as the stored one. It is committed by loop().
  */
-String ESP32AutoConnect::composeNetworkList()
+void ESP32AutoConnect::saveLink()
 {
-  String networks = "";
-  int n = WiFi.scanNetworks();
-  for (int i = 0; i <n; i++)
-  {
-    // <option value="0">Dodeka2G4</option>
-    char buf[64];
-    snprintf(buf, sizeof(buf), "<option value=\"%d\">%s</option>", i, WiFi.SSID(i).c_str()); 
-    networks += String(buf);
-  }
-  //log_i("%s", networks.c_str());
-  return networks;
-} 
+  WiFiLink link;
+  memset(&link, 0, sizeof(link));
+  memcpy(link.bssid, WiFi.BSSID(), sizeof(link.bssid));
+  link.channel = WiFi.channel();
+  link.ip      = WiFi.localIP();
+  link.gateway = WiFi.gatewayIP();
+  link.subnet  = WiFi.subnetMask();
+  link.dns     = WiFi.dnsIP();
+  if (_hasLink && memcmp(&link, &_link, sizeof(link)) == 0) return;
+
+  _link = link;
+  _hasLink = true;
+  _credentials.putBytes("link", &_link, sizeof(_link));
+  log_i("==> Stored link to %s on channel %d", WiFi.BSSIDstr().c_str(), _link.channel);
+}
 
 
 /**
- * Starts an access point, searches for available networks and prompts the user
- * on the query web page to select a network and enter the corresponding password
+ * Starts an access point, searches for available networks in the background 
+ * and prompts the user on the query web page to select a network and enter 
+ * the corresponding password
  */
 void ESP32AutoConnect::requestCredentialsAndRestart()
 {
-  Preferences& pr = _prefs;
+  Settings& cr = _credentials;
   String& hn = _hostname;
+  WiFiScanCache& scan = _scan;
   WiFi.disconnect();
   WiFi.softAP(_apSSID.c_str(), NULL);
   log_e("\n==> Connect your mobile to %s and \nenter your WLAN credentials on page http://%s", _apSSID.c_str(), WiFi.softAPIP().toString().c_str());
-
-  String networks = composeNetworkList();
-  String query = query0;
-  query.replace("{n}", networks); // insert available networks into query web page
+  _scan.refresh(true);
 
   _server.on("/", 
             HTTP_GET, 
-            [query](AsyncWebServerRequest *request)
+            [&scan](AsyncWebServerRequest *request)
               {
-                request->send(200, "text/html", query.c_str());
+                // The compressed page is streamed with the cached networks inserted.
+                // Stale results are refreshed in the background for the next request.
+                scan.refresh();
+                std::shared_ptr<PortalPage> page = std::make_shared<PortalPage>(scan);
+                AsyncWebServerResponse *response = request->beginChunkedResponse("text/html", 
+                    [page](uint8_t *buffer, size_t maxLen, size_t index) { return page->fill(buffer, maxLen); });
+                response->addHeader("Content-Encoding", "gzip");
+                request->send(response);
               });
 
   _server.on("/get",
             HTTP_GET,
-            [&pr, hn] (AsyncWebServerRequest *request) 
+            [&cr, hn] (AsyncWebServerRequest *request) 
             {
               String ssid, password;
               if (request->hasParam("ssid")) 
               {
-                int index = (request->getParam("ssid")->value()).toInt();
-                ssid = WiFi.SSID(index);
+                ssid = request->getParam("ssid")->value();  // decoded by the server
               }
               if (request->hasParam("password")) 
               {
                 password = request->getParam("password")->value();
               }
 
-              pr.begin("credentials", RW_MODE);
-              pr.putString("ssid", ssid);
-              pr.putString("password", password);
-              pr.end();
+              cr.clear();  // the link of the previous network is no longer valid
+              cr.putText("ssid", ssid.c_str());
+              cr.putText("password", password.c_str());
+              cr.commit(); // at once, the ESP restarts
 
               request->send(200, "text/html", 
                                  "Credentials saved. ESP will restart and<br>connect to your WLAN "
@@ -139,6 +160,7 @@ void ESP32AutoConnect::requestCredentialsAndRestart()
               ESP.restart();
             });
   _server.begin();    
+  setState(WiFiState::PORTAL);
 }
 
 
@@ -149,31 +171,166 @@ void notFound1(AsyncWebServerRequest *request)
 
 
 /**
- * Start the autoconnect process
+ * Starts the autoconnect process and returns at once. The WiFi 
+ * events only set flags, the state changes are made in loop().
  */
 void ESP32AutoConnect::autoConnect()
 {
-  bool notConnected = true;
+  WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info)
+              {
+                if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) _gotIP = true;
+                // The event of our own WiFi.disconnect() arrives late, after the
+                // next attempt has started. It must not abort this attempt.
+                if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED 
+                    && info.wifi_sta_disconnected.reason != WIFI_REASON_ASSOC_LEAVE) _disconnected = true;
+              });
 
+  _credentials.begin();  // the only NVS read, later reads are served from RAM
   if (credentialsAreAvailable())
   {
-    if (weAreConnectedToWLAN(_ssid, _password))
-    {
-      log_i("\n==> Connected to your WLAN %s. Proceed to http://%s or http://%s", _ssid, WiFi.getHostname(), WiFi.localIP().toString().c_str());
-      notConnected = false;
-    }
-    else
-    {
-      log_e("==> Could not connect to your WLAN %s, try again or select another network.", _ssid.c_str());
-      requestCredentialsAndRestart();
-    }
+    WiFi.setHostname(_hostname.c_str()); // set hostname first
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);        // reconnects are made with backoff by loop()
+    startConnecting();
   }
   else
   {
     log_e("==> No WiFi credentials available");
     requestCredentialsAndRestart();
   }
-  // The next line prevents the main loop from being entered 
-  // before a connection has been established. 
-  while (notConnected) { delay(100); }  
+}
+
+
+/**
+ * Advances the state machine, call it in the main loop
+ */
+void ESP32AutoConnect::loop()
+{
+  _scan.loop();
+  _credentials.loop();   // commits a changed link after the debounce time
+  bool gotIP = _gotIP.exchange(false);
+  bool disconnected = _disconnected.exchange(false);
+
+  switch (_state)
+  {
+    case WiFiState::CONNECTING:
+      if (gotIP)
+      {
+        log_i("\n==> Connected to your WLAN %s. Proceed to http://%s or http://%s", _ssid.c_str(), WiFi.getHostname(), WiFi.localIP().toString().c_str());
+        _attempts = 0;
+        _msBackoff = MS_BACKOFF_MIN;
+        _wasConnected = true;
+        saveLink();
+        setState(WiFiState::CONNECTED);
+      }
+      else if (disconnected || millis() - _msStateChange > (_isFastAttempt ? MS_FAST_TIMEOUT : MS_CONNECT_TIMEOUT))
+      {
+        connectionFailed();
+      }
+    break;
+
+    case WiFiState::WAITING:
+      if (millis() - _msStateChange >= _msBackoff)
+      {
+        _msBackoff = min(2 * _msBackoff, MS_BACKOFF_MAX);
+        startConnecting();
+      }
+    break;
+
+    case WiFiState::CONNECTED:
+      if (disconnected)
+      {
+        log_e("==> Lost connection to your WLAN %s", _ssid.c_str());
+        connectionFailed();
+      }
+    break;
+
+    default:
+    break;
+  }
+}
+
+
+// The first attempt of a series goes directly to the known access point
+void ESP32AutoConnect::startConnecting()
+{
+  _attempts++;
+  _isFastAttempt = (_hasLink && _attempts == 1);
+  _gotIP = false;
+  _disconnected = false;
+  if (_isFastAttempt)
+  {
+    log_i("==> Connecting to %s on channel %d", _ssid.c_str(), _link.channel);
+    if (_useCachedIP && _link.ip != 0) WiFi.config(_link.ip, _link.gateway, _link.subnet, _link.dns);
+    WiFi.begin(_ssid.c_str(), _password.c_str(), _link.channel, _link.bssid);
+  }
+  else
+  {
+    log_i("==> Connecting to %s, attempt %d", _ssid.c_str(), _attempts);
+    WiFi.begin(_ssid.c_str(), _password.c_str());
+  }
+  setState(WiFiState::CONNECTING);
+}
+
+
+// Waits before the next attempt. Without ever having been connected,
+// the credentials are requested after MAX_ATTEMPTS failed attempts.
+void ESP32AutoConnect::connectionFailed()
+{
+  WiFi.disconnect();
+  if (_isFastAttempt)  // the access point may have changed, connect the normal way
+  {
+    log_i("==> Fast reconnect failed");
+    if (_useCachedIP) WiFi.config(IPAddress(), IPAddress(), IPAddress());  // back to DHCP
+    startConnecting();
+    return;
+  }
+  if (! _wasConnected && _attempts >= MAX_ATTEMPTS)
+  {
+    log_e("==> Could not connect to your WLAN %s, try again or select another network.", _ssid.c_str());
+    requestCredentialsAndRestart();
+    return;
+  }
+  setState(WiFiState::WAITING);
+}
+
+
+void ESP32AutoConnect::setState(WiFiState state)
+{
+  _state = state;
+  _msStateChange = millis();
+  if (_callback) _callback(state);
+}
+
+
+void ESP32AutoConnect::onStateChange(WiFiStateCallback callback)
+{
+  _callback = callback;
+}
+
+
+WiFiState ESP32AutoConnect::state()
+{
+  return _state;
+}
+
+
+const char *ESP32AutoConnect::stateName()
+{
+  static const char *names[] = { "idle", "connecting", "waiting", "connected", "portal" };
+  return names[static_cast<uint8_t>(_state)];
+}
+
+
+// The cached results of the scans for nearby networks
+WiFiScanCache &ESP32AutoConnect::networks()
+{
+  return _scan;
+}
+
+
+// Number of attempts since the last successful connection
+uint8_t ESP32AutoConnect::attempts()
+{
+  return _attempts;
 }
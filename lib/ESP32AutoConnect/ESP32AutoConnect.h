@@ -8,31 +8,87 @@
 
 #include "Arduino.h"
 #include <ESPAsyncWebServer.h>
-#include <Preferences.h>
+#include <atomic>
+#include "Settings.h"
+#include "WiFiScanCache.h"
 
 #pragma once
 
+// States of the connection
+//   IDLE        autoConnect() not yet called
+//   CONNECTING  waiting for the IP address from the WLAN
+//   WAITING     the last attempt failed, waiting for the next one
+//   CONNECTED   connected to the WLAN
+//   PORTAL      access point started, waiting for the credentials
+enum class WiFiState : uint8_t { IDLE, CONNECTING, WAITING, CONNECTED, PORTAL };
+
+using WiFiStateCallback = void(*)(WiFiState state);
+
+// Access point and IP configuration of the last successful connection,
+// stored as one entry "link" in the NVS namespace "credentials"
+struct WiFiLink
+{
+    uint8_t  bssid[6];
+    uint8_t  channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
 class ESP32AutoConnect 
 {
     public:
-        ESP32AutoConnect(AsyncWebServer& server, Preferences& prefs, String hostname="esp-websrv") : 
-            _server(server), _prefs(prefs), _hostname(hostname) 
+        static const uint8_t  MAX_ATTEMPTS = 5;          // attempts before the portal is started
+        static const uint32_t MS_CONNECT_TIMEOUT = 15000; // an attempt fails without answer
+        static const uint32_t MS_FAST_TIMEOUT = 3000;     // a fast reconnect fails without answer
+        static const uint32_t MS_BACKOFF_MIN = 500;       // wait after the first failed attempt
+        static const uint32_t MS_BACKOFF_MAX = 60000;     // the wait doubles up to this limit
+        static const uint16_t CREDENTIALS_VERSION = 1;    // schema of the namespace "credentials"
+
+        ESP32AutoConnect(AsyncWebServer& server, String hostname="esp-websrv") : 
+            _server(server), _hostname(hostname) 
         {
+            _credentials.addText("ssid", "", 33);
+            _credentials.addText("password", "", 65);
+            _credentials.addBytes("link", sizeof(WiFiLink));
         }
 
         void autoConnect();
+        void loop();
         void clearCredentials();
+        void useCachedIP(bool enable);
+        void onStateChange(WiFiStateCallback callback);
+        WiFiState state();
+        const char *stateName();
+        uint8_t attempts();
+        WiFiScanCache &networks();
         
     private:
         bool credentialsAreAvailable();
-        bool weAreConnectedToWLAN(String ssid, String password);
+        void startConnecting();
+        void saveLink();
+        void connectionFailed();
+        void setState(WiFiState state);
         void requestCredentialsAndRestart();
-        String composeNetworkList();
+        WiFiScanCache _scan;
+        WiFiState _state = WiFiState::IDLE;
+        WiFiStateCallback _callback = nullptr;
+        std::atomic<bool> _gotIP{false};        // set by the WiFi event task, handled in loop()
+        std::atomic<bool> _disconnected{false};
+        bool     _wasConnected = false;
+        WiFiLink _link;
+        bool     _hasLink = false;       // a link from a previous connection is known
+        bool     _isFastAttempt = false; // connecting directly to the known access point
+        bool     _useCachedIP = false;   // skip DHCP with the IP configuration of the link
+        uint8_t  _attempts = 0;
+        uint32_t _msBackoff = MS_BACKOFF_MIN;
+        uint32_t _msStateChange = 0;
         String _apSSID = "AutoConnectAP";
         String _apPassword;
         String _ssid;
         String _password;
         String _hostname;
-        Preferences& _prefs;
+        Settings _credentials = Settings("credentials", CREDENTIALS_VERSION);  // loaded once, then read from RAM
         AsyncWebServer& _server;      
 };
\ No newline at end of file
@@ -0,0 +1,142 @@
+/**
+ * Class        Implementation of the class methods of PortalPage
+ * 
+ * Purpose      Streams the compressed query page of the portal
+ */
+#include "PortalPage.h"
+#include "query.h"
+#include <rom/crc.h>
+
+
+PortalPage::PortalPage(WiFiScanCache &scan) : 
+    _crc(QUERY_HEAD_CRC), _size(QUERY_HEAD_SIZE)
+{
+    _count = scan.copyTo(_networks);
+    _src = QUERY_HEAD_GZ;
+    _len = sizeof(QUERY_HEAD_GZ);
+}
+
+
+/**
+ * Fills buf with the next at most maxLen bytes of the response.
+ * Returns 0 when the page is complete.
+ */
+size_t PortalPage::fill(uint8_t *buf, size_t maxLen)
+{
+    size_t n = 0;
+    while (n < maxLen)
+    {
+        if (_pos == _len)
+        {
+            if (! nextPiece()) break;
+            _pos = 0;
+        }
+        size_t k = min(maxLen - n, _len - _pos);
+        memcpy_P(buf + n, _src + _pos, k);
+        n += k;
+        _pos += k;
+    }
+    return n;
+}
+
+
+// Copies s with the characters special to HTML escaped
+static size_t escapeHtml(const char *s, char *buf, size_t size)
+{
+    size_t n = 0;
+    for (; *s; s++)
+    {
+        const char *e = nullptr;
+        switch (*s)
+        {
+            case '&':  e = "&amp;";  break;
+            case '<':  e = "&lt;";   break;
+            case '>':  e = "&gt;";   break;
+            case '"':  e = "&quot;"; break;
+            case '\'': e = "&#39;";  break;
+        }
+        size_t len = e ? strlen(e) : 1;
+        if (n + len >= size) break;
+        if (e) memcpy(buf + n, e, len);
+        else buf[n] = *s;
+        n += len;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+
+// Prepares the next piece of the response. Returns false at the end.
+bool PortalPage::nextPiece()
+{
+    if (_next)  // the data of a block follows its header
+    {
+        _src = _next;
+        _len = _nextLen;
+        _next = nullptr;
+        return true;
+    }
+
+    switch (_part)
+    {
+        case Part::HEAD:
+            _part = Part::OPTIONS;
+            // fall through
+        case Part::OPTIONS:
+            if (_option < _count || (_count == 0 && _option == 0))
+            {
+                // <option value="Dodeka2G4">Dodeka2G4</option>, the SSID itself is
+                // submitted, the list may be rescanned and resorted meanwhile
+                char *text = reinterpret_cast<char *>(_block + 5);
+                char ssid[6*sizeof(WiFiNetwork::ssid)];
+                if (_count > 0) escapeHtml(_networks[_option].ssid, ssid, sizeof(ssid));
+                int len = (_count == 0) ? snprintf(text, sizeof(_block) - 5, "<option disabled>Scanning, reload the page</option>")
+                                        : snprintf(text, sizeof(_block) - 5, "<option value=\"%s\">%s</option>", ssid, ssid);
+                _option++;
+                storedBlock(_block + 5, min(len, static_cast<int>(sizeof(_block) - 6)), false);
+                return true;
+            }
+            _part = Part::TAIL;
+            // fall through
+        case Part::TAIL:
+            storedBlock(reinterpret_cast<const uint8_t *>(QUERY_TAIL), sizeof(QUERY_TAIL) - 1, true);
+            _next = reinterpret_cast<const uint8_t *>(QUERY_TAIL);
+            _nextLen = sizeof(QUERY_TAIL) - 1;
+            _part = Part::TRAILER;
+            return true;
+
+        case Part::TRAILER:
+            for (int i = 0; i < 4; i++) _block[i]   = _crc  >> (8*i);
+            for (int i = 0; i < 4; i++) _block[4+i] = _size >> (8*i);
+            _src = _block;
+            _len = 8;
+            _part = Part::DONE;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+// Writes the header of a stored deflate block into _block and adds 
+// the data to the CRC. Option data already follows the header in _block.
+void PortalPage::storedBlock(const uint8_t *data, size_t len, bool isFinal)
+{
+    _block[0] = isFinal ? 1 : 0;
+    _block[1] = len;
+    _block[2] = len >> 8;
+    _block[3] = ~len;
+    _block[4] = ~len >> 8;
+    add(data, len);
+    _src = _block;
+    _len = (data == _block + 5) ? 5 + len : 5;
+}
+
+
+void PortalPage::add(const uint8_t *data, size_t len)
+{
+    _crc = crc32_le(_crc, data, len);
+    _size += len;
+}
+// --- PortalPage ---
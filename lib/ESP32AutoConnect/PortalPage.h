@@ -0,0 +1,43 @@
+/**
+ * Header       PortalPage.h
+ * 
+ * Purpose      Declaration of the class PortalPage           
+ */
+
+#include "Arduino.h"
+#include "WiFiScanCache.h"
+
+#pragma once
+
+// Streams the gzip compressed query page with the list of nearby
+// networks in chunks. The compressed head of the page is copied from
+// flash, the <option> list and the tail of the page follow as stored
+// deflate blocks, then the gzip trailer with the CRC32 of the whole 
+// page. The networks are copied when the page is requested, so all 
+// chunks of one response see the same list.
+class PortalPage
+{
+    public:
+        PortalPage(WiFiScanCache &scan);
+        size_t fill(uint8_t *buf, size_t maxLen);
+
+    private:
+        enum class Part : uint8_t { HEAD, OPTIONS, TAIL, TRAILER, DONE };
+
+        bool nextPiece();
+        void storedBlock(const uint8_t *data, size_t len, bool isFinal);
+        void add(const uint8_t *data, size_t len);
+
+        WiFiNetwork _networks[WiFiScanCache::MAX_NETWORKS];
+        uint8_t  _count;
+        Part     _part = Part::HEAD;
+        uint8_t  _option = 0;        // next option of the list
+        uint8_t  _block[5 + 2*6*32 + 40];  // stored block header and option with the escaped SSID twice, or trailer
+        const uint8_t *_src = nullptr;  // piece being sent
+        size_t   _len = 0;
+        size_t   _pos = 0;
+        const uint8_t *_next = nullptr; // data following the block header in _block
+        size_t   _nextLen = 0;
+        uint32_t _crc;               // CRC32 and size of the uncompressed page
+        uint32_t _size;
+};
@@ -0,0 +1,146 @@
+/**
+ * Class        Implementation of the class methods of WiFiScanCache
+ * 
+ * Purpose      Caches the results of asynchronous scans for nearby networks
+ */
+#include "WiFiScanCache.h"
+
+
+/**
+ * Registers for the scan done event. Called by the 
+ * first scan, if not called before.
+ */
+void WiFiScanCache::begin()
+{
+    if (_isListening) return;
+    WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info)
+                 {
+                    _scanDone = true;
+                 }, ARDUINO_EVENT_WIFI_SCAN_DONE);
+    _isListening = true;
+}
+
+
+/**
+ * Asks loop() for a scan in the background unless the results are 
+ * still fresh. Returns true if a scan was requested.
+ */
+bool WiFiScanCache::refresh(bool force)
+{
+    if (! force && isFresh()) return false;
+    if (force) _isForced = true;
+    _isWanted = true;
+    return true;
+}
+
+
+/**
+ * Starts a requested scan and copies the results when 
+ * the scan is done, call it in the main loop
+ */
+void WiFiScanCache::loop()
+{
+    if (_isWanted.exchange(false)) startScan(_isForced.exchange(false));
+    if (! _isScanning || ! _scanDone.exchange(false)) return;
+    _isScanning = false;
+    collect();
+    if (_callback) _callback(*this);
+}
+
+
+// Starts a scan unless one is running or the results are still fresh
+void WiFiScanCache::startScan(bool force)
+{
+    begin();
+    if (_isScanning || (! force && isFresh())) return;
+    _scanDone = false;
+    _isScanning = (WiFi.scanNetworks(true) == WIFI_SCAN_RUNNING);
+}
+
+
+// Sorts the networks by descending RSSI while copying them. 
+// Of several access points with the same SSID the strongest is kept.
+// The results are sorted into a local list, then taken over under the lock.
+void WiFiScanCache::collect()
+{
+    WiFiNetwork networks[MAX_NETWORKS];
+    uint8_t count = 0;
+    int n = WiFi.scanComplete();
+    for (int i = 0; i < n; i++)
+    {
+        String ssid = WiFi.SSID(i);
+        int8_t rssi = WiFi.RSSI(i);
+        if (ssid.length() == 0) continue;  // hidden network
+
+        int j = 0;
+        while (j < count && strcmp(networks[j].ssid, ssid.c_str()) != 0) j++;
+        if (j < count)
+        {
+            if (rssi <= networks[j].rssi) continue;
+            for (; j < count-1; j++) networks[j] = networks[j+1]; // remove the weaker one
+            count--;
+        }
+
+        j = min(count, static_cast<uint8_t>(MAX_NETWORKS-1));
+        if (count == MAX_NETWORKS && rssi <= networks[j].rssi) continue;
+        for (; j > 0 && networks[j-1].rssi < rssi; j--) networks[j] = networks[j-1];
+        strlcpy(networks[j].ssid, ssid.c_str(), sizeof(networks[j].ssid));
+        networks[j].rssi = rssi;
+        networks[j].channel = WiFi.channel(i);
+        if (count < MAX_NETWORKS) count++;
+    }
+    WiFi.scanDelete();
+    portENTER_CRITICAL(&_lock);
+    memcpy(_networks, networks, count * sizeof(WiFiNetwork));
+    _count = count;
+    _hasResults = true;
+    _msScanned = millis();
+    portEXIT_CRITICAL(&_lock);
+}
+
+
+bool WiFiScanCache::isScanning()
+{
+    return _isScanning;
+}
+
+
+bool WiFiScanCache::isFresh()
+{
+    portENTER_CRITICAL(&_lock);
+    bool isFresh = _hasResults && millis() - _msScanned < MS_TTL;
+    portEXIT_CRITICAL(&_lock);
+    return isFresh;
+}
+
+
+uint8_t WiFiScanCache::count()
+{
+    return _count;
+}
+
+
+// Network i in the order of descending RSSI
+const WiFiNetwork &WiFiScanCache::network(uint8_t i)
+{
+    return _networks[i < _count ? i : 0];
+}
+
+
+// Copies the networks in the order of descending RSSI, returns their number
+uint8_t WiFiScanCache::copyTo(WiFiNetwork *networks)
+{
+    portENTER_CRITICAL(&_lock);
+    uint8_t count = _count;
+    memcpy(networks, _networks, count * sizeof(WiFiNetwork));
+    portEXIT_CRITICAL(&_lock);
+    return count;
+}
+
+
+// The callback is called from loop() when new results are available
+void WiFiScanCache::onUpdate(WiFiScanCallback callback)
+{
+    _callback = callback;
+}
+// --- WiFiScanCache ---
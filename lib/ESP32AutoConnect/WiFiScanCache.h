@@ -0,0 +1,64 @@
+/**
+ * Header       WiFiScanCache.h
+ * 
+ * Purpose      Declaration of the class WiFiScanCache           
+ */
+
+#include "Arduino.h"
+#include <WiFi.h>
+#include <atomic>
+
+#pragma once
+
+struct WiFiNetwork
+{
+    char    ssid[33];
+    int8_t  rssi;
+    uint8_t channel;
+};
+
+class WiFiScanCache;
+using WiFiScanCallback = void(*)(WiFiScanCache &scan);
+
+// Holds the results of the last scan for nearby networks, sorted by
+// descending RSSI, one entry per SSID. A scan runs in the background
+// (scanNetworks(true)), its completion is signalled by a WiFi event and
+// the results are copied by loop(). refresh() only starts a new scan
+// when the results are older than the time to live, so the portal page
+// and the diagnostics share the same results.
+// refresh(), isFresh() and copyTo() may be called from any task, e.g.
+// by the web server: refresh() only asks loop() to start the scan and
+// the results are copied under a lock. count() and network() are for
+// the task running loop(), e.g. in the update callback.
+class WiFiScanCache
+{
+    public:
+        static const uint8_t  MAX_NETWORKS = 16;
+        static const uint32_t MS_TTL = 30000;  // results younger than this are reused
+
+        void begin();
+        void loop();
+        bool refresh(bool force=false);
+        bool isScanning();
+        bool isFresh();
+        uint8_t count();
+        const WiFiNetwork &network(uint8_t i);
+        uint8_t copyTo(WiFiNetwork *networks);
+        void onUpdate(WiFiScanCallback callback);
+
+    private:
+        void startScan(bool force);
+        void collect();
+
+        WiFiNetwork _networks[MAX_NETWORKS];
+        uint8_t  _count = 0;
+        bool     _hasResults = false;
+        bool     _isScanning = false;
+        bool     _isListening = false;
+        uint32_t _msScanned = 0;
+        WiFiScanCallback _callback = nullptr;
+        std::atomic<bool> _scanDone{false};   // set by the WiFi event task
+        std::atomic<bool> _isWanted{false};   // set by refresh(), the scan is started by loop()
+        std::atomic<bool> _isForced{false};
+        portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;  // guards the results
+};
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""
+Generates query.h from query.html, the page on which the portal asks for
+the WLAN credentials.
+
+The part of the page before the placeholder {n} is stored as gzip header
+followed by raw deflate data, ended by a sync flush so the stream can be
+continued at a byte boundary. At runtime the <option> list of the nearby
+networks and the short rest of the page are appended as stored deflate 
+blocks and the gzip trailer is computed from the precomputed CRC32 of
+the head. The page thus stays compressed in flash and is never copied
+into RAM as a whole.
+
+Usage   python3 make_query_h.py     (run it after editing query.html)
+"""
+import gzip
+import os
+import zlib
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+PLACEHOLDER = b"{n}"
+
+
+def gzip_head(head):
+    header = bytes([0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 2, 0xff])  # deflate, no name, max compression
+    c = zlib.compressobj(9, zlib.DEFLATED, -15, 9)
+    return header + c.compress(head) + c.flush(zlib.Z_SYNC_FLUSH)
+
+
+def stored_block(data, final):
+    n = len(data)
+    return bytes([1 if final else 0, n & 0xff, n >> 8, ~n & 0xff, (~n >> 8) & 0xff]) + data
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i+16]) + ",")
+    return "\n".join(lines)
+
+
+def c_string(data):
+    text = data.decode("utf-8")
+    return 'R"rawliteral(' + text + ')rawliteral"'
+
+
+def main():
+    with open(os.path.join(HERE, "query.html"), "rb") as f:
+        page = f.read()
+    head, tail = page.split(PLACEHOLDER, 1)
+    gz = gzip_head(head)
+
+    # Check that the stream as composed at runtime decompresses to the page
+    options = b'<option value="0">Test</option>'
+    body = head + options + tail
+    stream = gz + stored_block(options, False) + stored_block(tail, True)
+    stream += (zlib.crc32(body) & 0xffffffff).to_bytes(4, "little") + len(body).to_bytes(4, "little")
+    assert gzip.decompress(stream) == body
+
+    with open(os.path.join(HERE, "query.h"), "w") as f:
+        f.write("""/**
+ * Header       query.h
+ * 
+ * Purpose      Page on which the portal asks for the WLAN credentials.
+ *              Generated by make_query_h.py from query.html, do not edit.
+ *              The head of the page up to the network list is gzip compressed,
+ *              the tail after it is plain text.
+ */
+#include <Arduino.h>
+
+#pragma once
+
+// %d bytes of html compressed to %d bytes
+const uint8_t QUERY_HEAD_GZ[] PROGMEM = {
+%s
+};
+const uint32_t QUERY_HEAD_SIZE = %d;
+const uint32_t QUERY_HEAD_CRC  = 0x%08x;
+
+const char QUERY_TAIL[] PROGMEM = %s;
+""" % (len(head), len(gz), c_bytes(gz), len(head), zlib.crc32(head) & 0xffffffff, c_string(tail)))
+    print("query.h: %d bytes of head compressed to %d, tail %d bytes" % (len(head), len(gz), len(tail)))
+
+
+if __name__ == "__main__":
+    main()
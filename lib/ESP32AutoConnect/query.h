@@ -1,103 +1,73 @@
-String query0 = R"rawliteral(
-<!DOCTYPE html>
-<html lang="en">
-<head>
-  <meta charset="UTF-8">
-  <meta name="viewport" content="width=device-width, initial-scale=1.0">
-  <title>Enter Credentials</title>
-  <style>
-    * {
-      margin: 0;
-      padding: 0;
-      box-sizing: border-box;
-    }
+/**
+ * Header       query.h
+ * 
+ * Purpose      Page on which the portal asks for the WLAN credentials.
+ *              Generated by make_query_h.py from query.html, do not edit.
+ *              The head of the page up to the network list is gzip compressed,
+ *              the tail after it is plain text.
+ */
+#include <Arduino.h>
 
-    html, body {
-      height: 100%;
-      font-family: Roboto, sans-serif;
-      font-size: 12pt;
-      overflow: hidden;
-      background-color: #171a1c;
-    }
+#pragma once
 
-    body {
-      display: grid;
-      grid-template-columns: 1fr;
-      grid-template-rows: 1fr;
-      align-items: center;
-      justify-items: center;
-    }
+// 2105 bytes of html compressed to 803 bytes
+const uint8_t QUERY_HEAD_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0xd4, 0x55, 0xdf, 0x6f, 0xd3, 0x30,
+    0x10, 0x7e, 0xdf, 0x5f, 0x71, 0x64, 0x42, 0x62, 0xa8, 0x69, 0x93, 0x6e, 0x1d, 0x6d, 0x68, 0x2a,
+    0xa1, 0x31, 0x24, 0x9e, 0x40, 0x6c, 0x3c, 0x20, 0xb4, 0x07, 0x37, 0x76, 0x13, 0x83, 0x63, 0x47,
+    0xb6, 0xbb, 0xb6, 0x20, 0xfe, 0x77, 0xce, 0xf9, 0x35, 0xb7, 0xab, 0xc6, 0x5e, 0x91, 0x22, 0xdb,
+    0xb9, 0x3b, 0x9f, 0xbf, 0xbb, 0xef, 0x7c, 0x9e, 0xbf, 0x78, 0xff, 0xe9, 0xea, 0xf6, 0xdb, 0xe7,
+    0x6b, 0x28, 0x6c, 0x29, 0x16, 0x27, 0x73, 0x37, 0x81, 0x20, 0x32, 0x4f, 0x03, 0x26, 0x03, 0x27,
+    0x60, 0x84, 0x2e, 0x4e, 0x00, 0xe6, 0x25, 0xb3, 0x04, 0xb2, 0x82, 0x68, 0xc3, 0x6c, 0x1a, 0x7c,
+    0xbd, 0xfd, 0x10, 0x4e, 0x83, 0x07, 0x85, 0x24, 0x25, 0x4b, 0x83, 0x7b, 0xce, 0x36, 0x95, 0xd2,
+    0x36, 0x80, 0x4c, 0x49, 0xcb, 0x24, 0x1a, 0x6e, 0x38, 0xb5, 0x45, 0x4a, 0xd9, 0x3d, 0xcf, 0x58,
+    0x58, 0xff, 0x0c, 0x80, 0x4b, 0x6e, 0x39, 0x11, 0xa1, 0xc9, 0x88, 0x60, 0x69, 0x3c, 0x8c, 0x1a,
+    0x47, 0x96, 0x5b, 0xc1, 0x16, 0xd7, 0xb8, 0x51, 0xc3, 0x95, 0x66, 0x14, 0xf7, 0xa3, 0x95, 0x99,
+    0x8f, 0x1a, 0x85, 0x33, 0x31, 0x76, 0xd7, 0xac, 0x00, 0x5e, 0xc3, 0xef, 0x7a, 0x06, 0x28, 0x89,
+    0xce, 0xb9, 0x4c, 0x20, 0x7a, 0xdb, 0x0a, 0x2a, 0x42, 0x29, 0x97, 0xb9, 0x27, 0x59, 0xaa, 0x6d,
+    0x68, 0xf8, 0xaf, 0x5a, 0xb8, 0x54, 0x9a, 0x32, 0x1d, 0xa2, 0xa8, 0xd1, 0xfe, 0x39, 0xa9, 0x27,
+    0x17, 0xf9, 0x00, 0x95, 0x74, 0xd7, 0x3b, 0x2e, 0x18, 0xcf, 0x0b, 0x9b, 0x40, 0x1c, 0x45, 0x2f,
+    0x3b, 0x4f, 0x2b, 0x0c, 0x2c, 0x5c, 0x91, 0x92, 0x8b, 0x5d, 0x02, 0x5f, 0xd4, 0x52, 0x59, 0x35,
+    0x00, 0x43, 0xa4, 0x09, 0x0d, 0xd3, 0x7c, 0xb5, 0x67, 0x86, 0x27, 0x32, 0xdc, 0x3d, 0xae, 0x6c,
+    0x27, 0x56, 0xf7, 0x4c, 0xaf, 0x84, 0xda, 0x24, 0x50, 0x70, 0x8a, 0x01, 0xf6, 0xf8, 0x48, 0xf6,
+    0x33, 0xd7, 0x6a, 0x2d, 0x69, 0x98, 0x29, 0xa1, 0x74, 0x02, 0xa7, 0xf1, 0x9b, 0x98, 0xc4, 0xd9,
+    0x1e, 0xc4, 0x3d, 0x70, 0x94, 0x9b, 0x4a, 0x10, 0x04, 0x91, 0x6b, 0x4e, 0x3b, 0x3f, 0x6e, 0x1d,
+    0x5a, 0x56, 0xa2, 0xc6, 0x32, 0xe7, 0x6a, 0x5d, 0x4a, 0x83, 0x10, 0x56, 0xfa, 0xb8, 0x85, 0x56,
+    0x9b, 0x7d, 0x35, 0x11, 0x3c, 0x97, 0x21, 0x47, 0x03, 0x94, 0x67, 0xcc, 0x71, 0xd1, 0xa9, 0x7e,
+    0xac, 0x8d, 0xe5, 0xab, 0xdd, 0x31, 0x65, 0x8b, 0xef, 0xb4, 0x22, 0x92, 0x89, 0x1e, 0x61, 0xcd,
+    0x36, 0x7a, 0x9f, 0x6a, 0x56, 0x3e, 0xc3, 0x89, 0xc7, 0x5b, 0x8c, 0x3b, 0x20, 0x6a, 0xa7, 0x27,
+    0x72, 0x34, 0x9e, 0x9d, 0x5f, 0x9e, 0xd3, 0x07, 0x92, 0x6b, 0x62, 0x35, 0xa1, 0x7c, 0x6d, 0x1a,
+    0x27, 0x7b, 0xfc, 0x17, 0x84, 0xba, 0xcc, 0x47, 0x30, 0xad, 0xb6, 0x10, 0x5f, 0xe2, 0xa0, 0xf3,
+    0x25, 0x79, 0x15, 0x0d, 0xa0, 0xfd, 0x86, 0x17, 0x67, 0xae, 0x38, 0xb1, 0xc0, 0xd1, 0x68, 0x8c,
+    0xfa, 0x8b, 0xce, 0x26, 0x9e, 0xcc, 0x06, 0x30, 0x8e, 0xc6, 0x38, 0x8c, 0xcf, 0x9d, 0xe5, 0x78,
+    0x72, 0xd6, 0x86, 0x0e, 0xd0, 0xd6, 0x4f, 0xdc, 0x07, 0xee, 0x93, 0x3f, 0x9c, 0x78, 0x30, 0x2c,
+    0xdb, 0x5a, 0x0f, 0xc7, 0xde, 0x11, 0x1e, 0x8c, 0xf3, 0xb3, 0xbd, 0x0d, 0x35, 0x27, 0x87, 0x09,
+    0xaf, 0xa3, 0x5a, 0x5b, 0xab, 0x64, 0x7f, 0xec, 0x91, 0x04, 0x5d, 0x5c, 0xbd, 0xfb, 0x30, 0xe9,
+    0x33, 0xd8, 0x11, 0xe2, 0x95, 0x73, 0x6b, 0xb8, 0x29, 0x90, 0x90, 0xc7, 0x34, 0x4c, 0xaa, 0xed,
+    0xdb, 0x83, 0x4b, 0x16, 0x47, 0x08, 0x38, 0x7a, 0x90, 0x37, 0x49, 0x4f, 0x40, 0x2a, 0xd9, 0x3b,
+    0xc8, 0xd6, 0xda, 0x38, 0xaf, 0x95, 0xe2, 0x3e, 0xbd, 0x07, 0xfc, 0xbc, 0xa9, 0xb6, 0x7e, 0x30,
+    0x2b, 0xa5, 0xcb, 0xa7, 0x8b, 0xfb, 0x78, 0x50, 0xfd, 0xed, 0x77, 0xc5, 0xd2, 0x54, 0x4c, 0xb7,
+    0xf2, 0xbc, 0x73, 0x59, 0xad, 0xed, 0x77, 0xbb, 0xab, 0x58, 0xea, 0x72, 0x7a, 0x37, 0xf0, 0x25,
+    0x15, 0x31, 0x66, 0x83, 0xe0, 0xee, 0x1e, 0x95, 0xae, 0x97, 0xa9, 0xee, 0x1c, 0x57, 0x3c, 0x8f,
+    0x3b, 0x4d, 0xec, 0xb8, 0x1c, 0x7b, 0x79, 0xe9, 0x23, 0xe0, 0x52, 0x70, 0xc9, 0xc2, 0xa5, 0x50,
+    0xd9, 0xcf, 0xc3, 0xa4, 0xb9, 0x4d, 0x46, 0x09, 0x4e, 0x31, 0x4e, 0xe6, 0x75, 0x83, 0x27, 0xba,
+    0xd5, 0xbf, 0xd2, 0xd8, 0xd4, 0x44, 0x52, 0xb8, 0x4e, 0xd3, 0x87, 0xa3, 0x2a, 0x92, 0x71, 0x8b,
+    0x60, 0xa2, 0xe1, 0x74, 0xef, 0xc6, 0x0e, 0x5b, 0x98, 0xcf, 0xe8, 0x2a, 0x39, 0xa9, 0x12, 0xc0,
+    0xba, 0xef, 0xcb, 0xb9, 0x73, 0xd1, 0x5c, 0x98, 0xdf, 0x07, 0x24, 0x5d, 0x5e, 0x4e, 0xa7, 0xb3,
+    0xd9, 0xd1, 0xc2, 0x0f, 0x63, 0x0c, 0xbb, 0x1e, 0x22, 0x38, 0x8d, 0xa2, 0xc8, 0x87, 0x6f, 0x98,
+    0x60, 0x99, 0xfd, 0xbf, 0x79, 0x70, 0x83, 0x7b, 0xac, 0x46, 0xed, 0x6b, 0x35, 0x1f, 0x35, 0x8f,
+    0xe8, 0xdc, 0xf5, 0xef, 0xfa, 0x19, 0xa3, 0xfc, 0x1e, 0x38, 0x4d, 0x83, 0xba, 0x5f, 0x06, 0xcd,
+    0x7b, 0x36, 0xc7, 0x06, 0x92, 0x09, 0xac, 0xc4, 0x34, 0xa8, 0x33, 0x1a, 0x2c, 0xde, 0xad, 0xad,
+    0xba, 0x52, 0x52, 0x62, 0x42, 0xd0, 0x45, 0xdc, 0x9a, 0xb9, 0xbd, 0xad, 0x5d, 0x1b, 0x5b, 0xeb,
+    0x00, 0x75, 0xf5, 0x1d, 0x22, 0x99, 0xe5, 0x4a, 0xa6, 0xc1, 0x28, 0x77, 0x4e, 0x5a, 0x55, 0xad,
+    0x16, 0x64, 0xc9, 0xc4, 0xe2, 0xe6, 0xe6, 0xe3, 0x7b, 0x48, 0x10, 0x5e, 0xf3, 0xeb, 0x1b, 0xb4,
+    0xd9, 0x77, 0xd0, 0x8c, 0xe1, 0x34, 0x68, 0x9f, 0xf5, 0x7a, 0xed, 0x1b, 0x02, 0xfc, 0x05, 0x00,
+    0x00, 0xff, 0xff,
+};
+const uint32_t QUERY_HEAD_SIZE = 2105;
+const uint32_t QUERY_HEAD_CRC  = 0xa9f57607;
 
-    #panel {
-      width: 18rem;
-      justify-items: center;
-      padding: 1rem 0 1rem 0;
-      background-color: #29363d;
-      border-radius: 1rem;
-      box-shadow: 0 8px 16px rgba(0, 0, 0, 0.4), inset 0 2px 4px rgba(159, 202, 223, 0.25);
-    }  
-
-    h1 {
-      font-size: 1.5rem;
-      text-shadow: 0 2px 4px rgba(0, 0, 0, 0.3);
-      text-align: center;
-    }
-    button {
-      background-color: #4CAF50;
-      width: 100%;
-      color: white;
-      padding: 15px;
-      margin: 10px 0px;
-      border: none;
-      cursor: pointer;
-      border-radius: 7px;
-    }
-    form {
-      display: grid;
-      color: #4CAF50;
-      margin: 0rem 1rem 0rem 1rem
-    }
-    input[type=text], input[type=password] {
-      width: 100%;
-      margin: 8px 0;
-      padding: 12px 20px;
-      display: inline-block;
-      border: 2px solid green;
-      box-sizing: border-box;
-      border-radius: 7px;
-    }
-    button:hover {
-      opacity: 0.8;
-    }
-
-    .display {
-      display: grid;
-      grid-gap: .25rem;
-    }
-
-    .inset {
-      color: #668899;
-      text-shadow: -1px -1px 0 #000;
-    }
-    select {
-      width: 100%;
-      margin: 8px 0;
-      padding: 12px 20px;
-      display: inline-block;
-      border: 2px solid green;
-      box-sizing: border-box;
-      border-radius: 7px;
-    }    
-  </style>
-</head>
-<body>
-  <div id="panel">
-    <h1 class="inset">AutoConnect</h1>
-    <div class="display">
-      <form action="/get">
-          <label>SSID : </label>
-          <select id="ssid" name="ssid">
-            {n}
+const char QUERY_TAIL[] PROGMEM = R"rawliteral(
           </select>
           <label>Password : </label>
           <input type="text" placeholder="Enter Password" name="password" required>
@@ -108,4 +78,4 @@ String query0 = R"rawliteral(
 
   </script>
 </body>
-</html>)rawliteral";
\ No newline at end of file
+</html>)rawliteral";
@@ -0,0 +1,161 @@
+#include "FileServer.h"
+#include <memory>
+
+// An open file streamed from offset start on. The file is closed
+// with the last reference, i.e. when the response is deleted.
+class SdFileStream
+{
+    public:
+        SdFileStream(SpiBus &bus, File file, uint32_t start, uint32_t length) :
+            _bus(bus), _file(file), _start(start), _length(length)
+        {}
+
+        ~SdFileStream()
+        {
+            SpiLock lock(_bus);
+            _file.close();
+        }
+
+        // Reads the next chunk straight into the buffer of the response
+        size_t fill(uint8_t *buf, size_t maxLen, size_t index)
+        {
+            if (index >= _length) return 0;
+            SpiLock lock(_bus, FileServer::MS_LOCK_TIMEOUT);
+            if (! lock) return RESPONSE_TRY_AGAIN;      // the card is busy writing
+            if (_file.position() != _start + index) _file.seek(_start + index);
+            int n = _file.read(buf, min(maxLen, static_cast<size_t>(_length - index)));
+            return n > 0 ? n : 0;
+        }
+
+    private:
+        SpiBus  &_bus;
+        File     _file;
+        uint32_t _start;
+        uint32_t _length;
+};
+
+
+static const char *contentType(const String &path)
+{
+    if (path.endsWith(".bmp"))  return "image/bmp";
+    if (path.endsWith(".json")) return "application/json";
+    if (path.endsWith(".htm") || path.endsWith(".html")) return "text/html";
+    if (path.endsWith(".txt") || path.endsWith(".csv") || path.endsWith(".log")) return "text/plain";
+    return "application/octet-stream";
+}
+
+/**
+ * Parses a range "bytes=first-last", "bytes=first-" or "bytes=-suffix"
+ * of a file of the given size. Returns false if the range is not
+ * satisfiable. Several ranges are not supported, the whole file is sent.
+ */
+static bool parseRange(const String &range, uint32_t size, uint32_t &first, uint32_t &last)
+{
+    first = 0;
+    last = size - 1;
+    if (! range.startsWith("bytes=") || range.indexOf(',') >= 0) return true;
+    const char *p = range.c_str() + 6;
+    char *end;
+    if (*p == '-')
+    {
+        uint32_t suffix = strtoul(p + 1, &end, 10);
+        if (suffix == 0) return false;
+        first = (suffix < size) ? size - suffix : 0;
+        return true;
+    }
+    first = strtoul(p, &end, 10);
+    if (end == p || *end != '-' || first >= size) return false;
+    if (isdigit(end[1])) last = min(static_cast<uint32_t>(strtoul(end + 1, nullptr, 10)), size - 1);
+    return first <= last;
+}
+
+
+// Registers the HTTP endpoints, call it when the WLAN is connected
+void FileServer::serve(AsyncWebServer &server)
+{
+    server.on("/api/file", HTTP_GET, [this](AsyncWebServerRequest *request) { sendFile(request); });
+    server.on("/api/screenshot.bmp", HTTP_GET, [this](AsyncWebServerRequest *request) { sendScreen(request); });
+}
+
+// Reads the rows of a screenshot being streamed
+void FileServer::loop()
+{
+    _screen.loop();
+}
+
+void FileServer::sendFile(AsyncWebServerRequest *request)
+{
+    if (! request->hasParam("path"))
+    {
+        request->send(400, "text/plain", "path missing");
+        return;
+    }
+    String path = request->getParam("path")->value();
+    if (! path.startsWith("/") || path.indexOf("..") >= 0)
+    {
+        request->send(400, "text/plain", "bad path");
+        return;
+    }
+
+    File file;
+    {
+        SpiLock lock(_bus);
+        if (! lock)
+        {
+            request->send(503);
+            return;
+        }
+        file = SD.open(path, FILE_READ);
+        if (file && file.isDirectory()) file.close();
+    }
+    if (! file)
+    {
+        request->send(404, "text/plain", "not found");
+        return;
+    }
+
+    uint32_t size = file.size();
+    uint32_t first = 0;
+    uint32_t last = size - 1;
+    bool isRange = request->hasHeader("Range") && size > 0;
+    if (isRange && ! parseRange(request->getHeader("Range")->value(), size, first, last))
+    {
+        { SpiLock lock(_bus); file.close(); }
+        char buf[32];
+        snprintf(buf, sizeof(buf), "bytes */%lu", static_cast<unsigned long>(size));
+        AsyncWebServerResponse *response = request->beginResponse(416);
+        response->addHeader("Content-Range", buf);
+        request->send(response);
+        return;
+    }
+
+    uint32_t length = size ? last - first + 1 : 0;
+    std::shared_ptr<SdFileStream> stream = std::make_shared<SdFileStream>(_bus, file, first, length);
+    AsyncWebServerResponse *response = request->beginResponse(contentType(path), length,
+        [stream](uint8_t *buffer, size_t maxLen, size_t index) { return stream->fill(buffer, maxLen, index); });
+    response->addHeader("Accept-Ranges", "bytes");
+    if (isRange)
+    {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "bytes %lu-%lu/%lu", static_cast<unsigned long>(first),
+                 static_cast<unsigned long>(last), static_cast<unsigned long>(size));
+        response->addHeader("Content-Range", buf);
+        response->setCode(206);
+    }
+    request->send(response);
+}
+
+void FileServer::sendScreen(AsyncWebServerRequest *request)
+{
+    if (! _screen.begin())
+    {
+        request->send(503, "text/plain", "busy");
+        return;
+    }
+    request->onDisconnect([this]() { _screen.end(); });
+    AsyncWebServerResponse *response = request->beginResponse("image/bmp", _screen.size(),
+        [this](uint8_t *buffer, size_t maxLen, size_t index) { return _screen.fill(buffer, maxLen); });
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+}
+// --- FileServer ---
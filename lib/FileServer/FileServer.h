@@ -0,0 +1,46 @@
+#include <Arduino.h>
+#include <SD.h>
+#include <ESPAsyncWebServer.h>
+#include "lgfx_ESP32_2432S028.h"
+#include "SpiBus.h"
+#include "ScreenStream.h"
+
+#pragma once
+
+/**
+ * Class        FileServer
+ *
+ * Purpose      Serves the files of the SD card and the screen over HTTP.
+ *              GET /api/file?path=/SCREENSHOTS/screen000.bmp streams a file
+ *              in chunks read straight into the buffer of the response, so
+ *              no file is held in RAM. A Range header like "bytes=0-1023"
+ *              is answered with 206 and only this part of the file, e.g.
+ *              to resume a download of a log segment.
+ *              GET /api/screenshot.bmp renders the current screen as BMP
+ *              directly into the response, the card is not touched.
+ *
+ * Usage        FileServer fileServer(sdBus, lcd);
+ *              fileServer.serve(server);   // when the WLAN is connected
+ *              fileServer.loop();          // in loop(), after the frame is drawn
+ *
+ * Remarks      The display is only read by the task running loop(), the
+ *              response waits for the rows (see ScreenStream). Only one
+ *              screenshot is streamed at a time, a second request gets 503.
+ */
+class FileServer
+{
+    public:
+        static const uint32_t MS_LOCK_TIMEOUT = 20;  // then the chunk is tried again
+
+        FileServer(SpiBus &bus, LGFX &lcd) : _bus(bus), _screen(lcd) {}
+
+        void serve(AsyncWebServer &server);
+        void loop();
+
+    private:
+        void sendFile(AsyncWebServerRequest *request);
+        void sendScreen(AsyncWebServerRequest *request);
+
+        SpiBus      &_bus;
+        ScreenStream _screen;
+};
@@ -0,0 +1,118 @@
+/**
+ * Class        Implementation of the class methods of ScreenStream
+ *
+ * Purpose      Streams the screen as BMP without a file and without
+ *              a frame buffer
+ */
+#include <ESPAsyncWebServer.h>
+#include "ScreenStream.h"
+
+
+/**
+ * Claims the stream and prepares the BMP header for the current
+ * size of the screen. Returns false if a screen is already streamed.
+ */
+bool ScreenStream::begin()
+{
+    if (_isBusy.exchange(true)) return false;
+    _width  = min(static_cast<int>(_lcd.width()), MAX_WIDTH);
+    _height = _lcd.height();
+    _rowSize = (2 * _width + 3) & ~ 3;
+
+    _header = {};
+    _header.bfType = 0x4D42;
+    _header.bfSize = _rowSize * _height + sizeof(_header);
+    _header.bfOffBits = sizeof(_header);
+    _header.biSize = 40;
+    _header.biWidth = _width;
+    _header.biHeight = _height;
+    _header.biPlanes = 1;
+    _header.biBitCount = 16;
+    _header.biCompression = 3;
+
+    for (Band &band : _bands)
+    {
+        memset(band.data, 0, sizeof(band.data));   // the padding of the rows stays 0
+        band.isReady = false;
+    }
+    _headerPos = 0;
+    _bandPos = 0;
+    _remaining = _header.bfSize;
+    _row = _height - 1;
+    _loopBand = 0;
+    _fillBand = 0;
+    _isActive = true;       // hands the stream over to loop()
+    return true;
+}
+
+// Asks loop() to release the stream, call it when the request is gone
+void ScreenStream::end()
+{
+    _isCancelled = true;
+}
+
+// The size of the BMP in bytes
+size_t ScreenStream::size() const
+{
+    return _header.bfSize;
+}
+
+/**
+ * Fills buf with the next at most maxLen bytes of the BMP. Returns
+ * RESPONSE_TRY_AGAIN while loop() has not yet read the next band.
+ * Runs in the task of the web server.
+ */
+size_t ScreenStream::fill(uint8_t *buf, size_t maxLen)
+{
+    size_t n = 0;
+    if (_headerPos < sizeof(_header))
+    {
+        n = min(maxLen, sizeof(_header) - _headerPos);
+        memcpy(buf, reinterpret_cast<const uint8_t *>(&_header) + _headerPos, n);
+        _headerPos += n;
+    }
+    while (n < maxLen && _bands[_fillBand].isReady)
+    {
+        Band &band = _bands[_fillBand];
+        size_t k = min(maxLen - n, band.len - _bandPos);
+        memcpy(buf + n, band.data + _bandPos, k);
+        n += k;
+        _bandPos += k;
+        if (_bandPos == band.len)
+        {
+            _bandPos = 0;
+            band.isReady = false;   // loop() may read into it again
+            _fillBand ^= 1;
+        }
+    }
+    _remaining -= n;
+    if (n == 0 && _remaining > 0) return RESPONSE_TRY_AGAIN;
+    return n;
+}
+
+/**
+ * Reads the next band of rows into a free band, releases the
+ * stream when it has ended. Call it in the loop, after the frame 
+ * has been drawn.
+ */
+void ScreenStream::loop()
+{
+    if (_isCancelled.exchange(false))
+    {
+        _isActive = false;
+        _isBusy = false;
+        return;
+    }
+    if (! _isActive || _row < 0) return;
+    Band &band = _bands[_loopBand];
+    if (band.isReady) return;   // both bands wait for fill()
+    int rows = min(static_cast<int>(BAND_ROWS), _row + 1);
+    for (int i = 0; i < rows; i++, _row--)
+    {
+        _lcd.readRect(0, _row, _width, 1, reinterpret_cast<lgfx::rgb565_t *>(band.data + i * _rowSize));
+    }
+    band.len = rows * _rowSize;
+    band.isReady = true;        // hands the band over to fill()
+    _loopBand ^= 1;
+}
+// --- ScreenStream ---
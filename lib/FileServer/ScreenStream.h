@@ -0,0 +1,62 @@
+/**
+ * Header       ScreenStream.h
+ *
+ * Purpose      Declaration of the class ScreenStream
+ */
+
+#include <Arduino.h>
+#include <LovyanGFX.hpp>
+#include <atomic>
+#include "lgfx_ESP32_2432S028.h"
+
+#pragma once
+
+// Streams the screen as 16 bit BMP, the rows bottom-up as in the
+// screenshots saved to the card. The response runs in the task of
+// the web server, but the display must only be read by the task
+// drawing it. So the rows are read in bands of a few rows by loop()
+// and handed over to fill(), which copies them into the response.
+// There are two bands: loop() reads the next one while fill() drains
+// the other, so fill() rarely has to ask to be called again, which
+// AsyncTCP would only do at its next poll.
+// The stream is only reset by loop(), never while a band is read.
+class ScreenStream
+{
+    public:
+        static const uint8_t BAND_ROWS = 8;
+        static const int     MAX_WIDTH = 320;
+
+        ScreenStream(LGFX &lcd) : _lcd(lcd) {}
+
+        bool   begin();
+        void   end();
+        size_t size() const;
+        size_t fill(uint8_t *buf, size_t maxLen);
+        void   loop();
+
+    private:
+        static const int MAX_ROW_SIZE = (2*MAX_WIDTH + 3) & ~3;
+
+        struct Band
+        {
+            std::atomic<bool> isReady{false};   // set by loop(), cleared by fill()
+            size_t  len = 0;
+            uint8_t data[BAND_ROWS * MAX_ROW_SIZE];
+        };
+
+        LGFX  &_lcd;
+        std::atomic<bool> _isBusy{false};       // claimed by begin(), released by loop()
+        std::atomic<bool> _isActive{false};     // loop() reads bands
+        std::atomic<bool> _isCancelled{false};  // end() asks loop() to reset the stream
+        lgfx::bitmap_header_t _header;
+        int    _width = 0;
+        int    _height = 0;
+        int    _rowSize = 0;
+        Band   _bands[2];
+        int    _row = 0;            // next row to read by loop(), counting down
+        uint8_t _loopBand = 0;      // band read next by loop()
+        uint8_t _fillBand = 0;      // band drained next by fill()
+        size_t _headerPos = 0;
+        size_t _bandPos = 0;
+        size_t _remaining = 0;      // bytes not yet passed to the response
+};
@@ -0,0 +1,165 @@
+#include "LocalClock.h"
+
+static const int32_t SECS_PER_DAY = 86400;
+static const time_t  WEEK = 7*SECS_PER_DAY;
+static const int     MAX_WEEKS = 53;         // search a year for the next transition
+
+
+// Days since 1970-01-01 of a civil date, month 1..12
+// http://howardhinnant.github.io/date_algorithms.html
+static int32_t daysFromCivil(int y, int m, int d)
+{
+    y -= m <= 2;
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    int32_t yoe = y - era*400;
+    int32_t doy = (153*(m + (m > 2 ? -3 : 9)) + 2)/5 + d - 1;
+    int32_t doe = yoe*365 + yoe/4 - yoe/100 + doy;
+    return era*146097 + doe - 719468;
+}
+
+
+// Floor division, also for local times before 1970
+static int32_t floorDiv(int64_t a, int32_t b)
+{
+    return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+
+void LocalClock::onChange(ClockCallback cb)
+{
+    _onChange = cb;
+}
+
+/**
+ * Brings the fields up to the system time and returns the changed
+ * fields as CLOCK_ flags, 0 while the time is not set. Calls the
+ * callback if a field changed.
+ */
+uint8_t LocalClock::update()
+{
+    time_t now = time(nullptr);
+    if (now < MIN_EPOCH || (_isValid && now == _epoch)) return 0;
+
+    uint8_t changed = 0;
+    if (!_isValid || now < _validFrom || now >= _nextTransition)
+    {
+        setOffset(now);
+        changed = CLOCK_ALL;
+    }
+    _isValid = true;
+    _epoch = now;
+
+    int64_t local = static_cast<int64_t>(now) + _offset;
+    int32_t days = floorDiv(local, SECS_PER_DAY);
+    int32_t secs = local - static_cast<int64_t>(days)*SECS_PER_DAY;
+    int hour = secs / 3600;
+    int minute = secs / 60 % 60;
+    int sec  = secs % 60;
+
+    if (days != _days) { setDate(days); changed |= CLOCK_DATE; }
+    if (hour != _tm.tm_hour)  { _tm.tm_hour = hour;  changed |= CLOCK_HOUR; }
+    if (minute != _tm.tm_min) { _tm.tm_min = minute; changed |= CLOCK_MINUTE; }
+    if (sec != _tm.tm_sec)    { _tm.tm_sec = sec;    changed |= CLOCK_SECOND; }
+
+    if (changed && _onChange) _onChange(*this, changed);
+    return changed;
+}
+
+// Forces the offset and all fields to be recomputed, e.g. after setting the time zone
+void LocalClock::invalidate()
+{
+    _isValid = false;
+    _days = -1;
+}
+
+bool LocalClock::isValid() const
+{
+    return _isValid;
+}
+
+// The local time, tm_isdst is not maintained
+const tm &LocalClock::local() const
+{
+    return _tm;
+}
+
+// UTC seconds at which the offset is determined again
+time_t LocalClock::nextTransition() const
+{
+    return _nextTransition;
+}
+
+// Formats the time as hh:mm:ss
+size_t LocalClock::formatTime(char *buf, size_t size) const
+{
+    return snprintf(buf, size, "%02d:%02d:%02d", _tm.tm_hour, _tm.tm_min, _tm.tm_sec);
+}
+
+// Formats the date as YYYY-MM-DD
+size_t LocalClock::formatDate(char *buf, size_t size) const
+{
+    return snprintf(buf, size, "%04d-%02d-%02d", _tm.tm_year + 1900, _tm.tm_mon + 1, _tm.tm_mday);
+}
+
+/**
+ * Determines the offset at now and searches the next transition, first
+ * week by week, then by bisection to the second. This costs about 70 calls
+ * of localtime_r() and is done at boot, at a DST change and after the 
+ * time was set backwards.
+ */
+void LocalClock::setOffset(time_t now)
+{
+    _offset = offsetAt(now);
+    _validFrom = now;
+    time_t lo = now;
+    time_t hi = now;
+    for (int i = 0; i < MAX_WEEKS; i++)
+    {
+        hi = lo + WEEK;
+        if (offsetAt(hi) != _offset) break;
+        lo = hi;
+    }
+    if (offsetAt(hi) == _offset)   // no DST in this time zone, check again in a year
+    {
+        _nextTransition = hi;
+        return;
+    }
+    while (hi - lo > 1)
+    {
+        time_t mid = lo + (hi - lo)/2;
+        (offsetAt(mid) == _offset ? lo : hi) = mid;
+    }
+    _nextTransition = hi;
+}
+
+// Local time - UTC at t in seconds
+int32_t LocalClock::offsetAt(time_t t) const
+{
+    tm lt;
+    localtime_r(&t, &lt);
+    int64_t local = static_cast<int64_t>(daysFromCivil(lt.tm_year + 1900, lt.tm_mon + 1, lt.tm_mday))*SECS_PER_DAY
+                  + lt.tm_hour*3600 + lt.tm_min*60 + lt.tm_sec;
+    return local - t;
+}
+
+// Sets the date fields from the local days since 1970-01-01
+void LocalClock::setDate(int32_t days)
+{
+    int32_t z = days + 719468;
+    int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int32_t doe = z - era*146097;
+    int32_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+    int32_t doy = doe - (365*yoe + yoe/4 - yoe/100);
+    int32_t mp  = (5*doy + 2)/153;
+    int d = doy - (153*mp + 2)/5 + 1;
+    int m = mp < 10 ? mp + 3 : mp - 9;
+    int y = yoe + era*400 + (m <= 2);
+
+    _days = days;
+    _tm.tm_year = y - 1900;
+    _tm.tm_mon  = m - 1;
+    _tm.tm_mday = d;
+    _tm.tm_wday = (days + 4) % 7 < 0 ? (days + 4) % 7 + 7 : (days + 4) % 7;  // 1970-01-01 was a thursday
+    _tm.tm_yday = days - daysFromCivil(y, 1, 1);
+}
+// --- LocalClock ---
@@ -0,0 +1,70 @@
+#include <Arduino.h>
+#include <time.h>
+
+#pragma once
+
+// Fields of the local time that changed in an update
+const uint8_t CLOCK_SECOND = 0x01;
+const uint8_t CLOCK_MINUTE = 0x02;
+const uint8_t CLOCK_HOUR   = 0x04;
+const uint8_t CLOCK_DATE   = 0x08;
+const uint8_t CLOCK_ALL    = 0x0f;
+
+class LocalClock;
+using ClockCallback = void(*)(const LocalClock &clock, uint8_t changed);
+
+/**
+ * Class        LocalClock
+ * 
+ * Purpose      Keeps the local time broken down into its fields without 
+ *              evaluating the TZ rules every second. The UTC offset is 
+ *              determined with localtime_r() only when the clock is set
+ *              or the next DST transition is reached, the time in between 
+ *              is the UTC seconds plus this offset. The time of day is 
+ *              split by integer division, the date is only recomputed 
+ *              when the day changes. update() reports which fields changed,
+ *              so the date is repainted once a day.
+ * 
+ * Usage        LocalClock localClock;
+ *              void onClock(const LocalClock &clock, uint8_t changed)
+ *              {
+ *                  char buf[12];
+ *                  if (changed & CLOCK_SECOND) { clock.formatTime(buf, sizeof(buf)); ... }
+ *                  if (changed & CLOCK_DATE)   { clock.formatDate(buf, sizeof(buf)); ... }
+ *              }
+ *              localClock.onChange(onClock);
+ *              void loop() { if (waitDateTime.isOver()) localClock.update(); }
+ * 
+ * Remarks      The time zone is set with setenv("TZ", ...) by restoreRTC()
+ *              or configTzTime(). The seconds come from the system time,
+ *              which the RTC timer keeps running and SNTP adjusts. After 
+ *              a change of the time zone call invalidate().
+ */
+class LocalClock
+{
+    public:
+        static const time_t MIN_EPOCH = 1700000000;  // earlier times are not set
+
+        void    onChange(ClockCallback cb);
+        uint8_t update();
+        void    invalidate();
+        bool    isValid() const;
+        const tm &local() const;
+        time_t  nextTransition() const;
+        size_t  formatTime(char *buf, size_t size) const;
+        size_t  formatDate(char *buf, size_t size) const;
+
+    private:
+        void   setOffset(time_t now);
+        int32_t offsetAt(time_t t) const;
+        void   setDate(int32_t days);
+
+        ClockCallback _onChange = nullptr;
+        bool    _isValid = false;
+        time_t  _epoch = 0;          // UTC seconds of the last update
+        time_t  _validFrom = 0;      // _offset is valid from
+        time_t  _nextTransition = 0; // ... up to the next DST transition
+        int32_t _offset = 0;         // local time - UTC in seconds
+        int32_t _days = -1;          // local days since 1970-01-01
+        tm      _tm = {};
+};
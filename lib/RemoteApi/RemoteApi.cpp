@@ -0,0 +1,272 @@
+#include "RemoteApi.h"
+#include <cmath>
+
+
+// Copies s as quoted JSON string into buf, truncated to size
+static void quote(const char *s, char *buf, size_t size)
+{
+    size_t n = 0;
+    buf[n++] = '"';
+    for (; *s && n < size - 2; s++)
+    {
+        bool isEscaped = (*s == '"' || *s == '\\');
+        if (isEscaped && n >= size - 3) break;
+        if (isEscaped) buf[n++] = '\\';
+        buf[n++] = (static_cast<uint8_t>(*s) < ' ') ? ' ' : *s;
+    }
+    buf[n++] = '"';
+    buf[n] = '\0';
+}
+
+
+/**
+ * Extracts the value of key from a flat JSON object, strings are
+ * unquoted. Sufficient for the messages {"id":"x","value":...}.
+ */
+static bool jsonValue(const char *json, const char *key, char *buf, size_t size)
+{
+    char name[20];
+    snprintf(name, sizeof(name), "\"%s\"", key);
+    const char *p = strstr(json, name);
+    if (p == nullptr) return false;
+    p += strlen(name);
+    while (*p == ' ' || *p == ':') p++;
+    size_t n = 0;
+    if (*p == '"')
+    {
+        for (p++; *p && *p != '"' && n < size - 1; p++)
+        {
+            if (*p == '\\' && p[1]) p++;
+            buf[n++] = *p;
+        }
+    }
+    else
+    {
+        for (; *p && *p != ',' && *p != '}' && *p != ' ' && n < size - 1; p++) buf[n++] = *p;
+    }
+    buf[n] = '\0';
+    return n > 0;
+}
+
+
+// Parses a finite number, the whole text must be numeric
+static bool parseNumber(const char *text, double &v)
+{
+    char *end;
+    v = strtod(text, &end);
+    while (*end == ' ') end++;
+    return end != text && *end == '\0' && std::isfinite(v);
+}
+
+
+// A value field, read only unless isWritable
+bool RemoteApi::addField(const char *id, UiButton *field, bool isWritable)
+{
+    return add(id, field, RemoteType::FIELD, isWritable);
+}
+
+bool RemoteApi::addSlider(const char *id, UiSlider *slider)
+{
+    return add(id, slider, RemoteType::SLIDER, true);
+}
+
+bool RemoteApi::addLed(const char *id, UiLed *led)
+{
+    return add(id, led, RemoteType::LED, true);
+}
+
+// The callback is called by the UI task after a widget has been written
+void RemoteApi::onWrite(Callback cb)
+{
+    _onWrite = cb;
+}
+
+/**
+ * Takes the current values and registers the handlers.
+ * Call it when the WLAN is connected.
+ */
+void RemoteApi::begin()
+{
+    if (_isStarted) return;
+    _isStarted = true;
+    for (int i = 0; i < _count; i++) readValue(_widgets[i], _widgets[i].json, RemoteWidget::VALUE_SIZE);
+
+    _server.on("/api/widgets", HTTP_GET, [this](AsyncWebServerRequest *request)
+    {
+        request->send(200, "application/json", allToJson());
+    });
+
+    _server.on("/api/widget", HTTP_GET, [this](AsyncWebServerRequest *request)
+    {
+        int i = request->hasParam("id") ? find(request->getParam("id")->value().c_str()) : -1;
+        if (i < 0) request->send(404, "application/json", "{\"error\":\"unknown id\"}");
+        else request->send(200, "application/json", toJson(i));
+    });
+
+    _server.on("/api/widget", HTTP_POST, [this](AsyncWebServerRequest *request)
+    {
+        if (! request->hasParam("id", true) || ! request->hasParam("value", true))
+        {
+            request->send(400, "application/json", "{\"error\":\"id and value required\"}");
+            return;
+        }
+        int code = post(request->getParam("id", true)->value().c_str(), request->getParam("value", true)->value().c_str());
+        request->send(code, "application/json", code == 202 ? "{\"queued\":true}" : "{\"queued\":false}");
+    });
+
+    _ws.onEvent([this](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len)
+    {
+        if (type == WS_EVT_CONNECT)
+        {
+            client->text(allToJson());
+        }
+        else if (type == WS_EVT_DATA)
+        {
+            AwsFrameInfo *info = static_cast<AwsFrameInfo*>(arg);
+            if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) handleMessage(data, len);
+        }
+    });
+    _server.addHandler(&_ws);
+    _server.begin();
+    log_i("==> Remote API with %d widgets started", _count);
+}
+
+/**
+ * Call it in the loop of the UI task. Pushes the values that 
+ * have changed since they were last sent.
+ */
+void RemoteApi::loop()
+{
+    if (! _isStarted) return;
+    if (millis() - _msLastPush < MS_PUSH_PERIOD) return;
+    _msLastPush = millis();
+    _ws.cleanupClients();
+    for (int i = 0; i < _count; i++)
+    {
+        char json[RemoteWidget::VALUE_SIZE];
+        readValue(_widgets[i], json, sizeof(json));
+        if (strcmp(json, _widgets[i].json) == 0) continue;
+        portENTER_CRITICAL(&_lock);
+        strlcpy(_widgets[i].json, json, RemoteWidget::VALUE_SIZE);
+        portEXIT_CRITICAL(&_lock);
+        if (_ws.count() > 0) _ws.textAll(toJson(i));
+    }
+}
+
+bool RemoteApi::add(const char *id, UiButton *widget, RemoteType type, bool isWritable)
+{
+    if (_count >= MAX_WIDGETS || find(id) >= 0) return false;
+    RemoteWidget &w = _widgets[_count];
+    w.id = id;
+    w.widget = widget;
+    w.type = type;
+    w.isWritable = isWritable;
+    readValue(w, w.json, sizeof(w.json));
+    _count++;
+    return true;
+}
+
+int RemoteApi::find(const char *id) const
+{
+    for (int i = 0; i < _count; i++)
+    {
+        if (strcmp(_widgets[i].id, id) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * Posts a write to the UI queue, called by the web server task.
+ * Returns the HTTP status: 202 queued, 400 not a finite number,
+ * 404 unknown id, 403 read only, 503 queue full.
+ */
+int RemoteApi::post(const char *id, const char *value)
+{
+    int i = find(id);
+    if (i < 0) return 404;
+    RemoteWidget &w = _widgets[i];
+    if (! w.isWritable) return 403;
+    bool isPosted = false;
+    double v;
+    switch (w.type)
+    {
+        case RemoteType::FIELD:
+            if (w.widget->getNumber().isNumeric() && ! parseNumber(value, v)) return 400;
+            isPosted = _queue.postText(w.widget, value, _onWrite);
+        break;
+
+        case RemoteType::SLIDER:
+            if (! parseNumber(value, v)) return 400;
+            isPosted = _queue.postSlide(static_cast<UiSlider*>(w.widget), v, _onWrite);
+        break;
+
+        case RemoteType::LED:
+        {
+            bool isOn = (strcmp(value, "true") == 0 || strcmp(value, "on") == 0 || strcmp(value, "1") == 0);
+            isPosted = _queue.postLed(static_cast<UiLed*>(w.widget), isOn, _onWrite);
+        }
+        break;
+    }
+    return isPosted ? 202 : 503;
+}
+
+// Formats the value of a widget as JSON literal, runs in the UI task.
+// JSON has no NaN or infinity, such values are sent as null.
+void RemoteApi::readValue(const RemoteWidget &w, char *buf, size_t size)
+{
+    if (w.type == RemoteType::LED)
+    {
+        strlcpy(buf, static_cast<UiLed*>(w.widget)->isOn() ? "true" : "false", size);
+        return;
+    }
+    const UiValue &number = w.widget->getNumber();
+    if (number.isNumeric() && ! std::isfinite(number.toDouble())) strlcpy(buf, "null", size);
+    else if (number.isNumeric()) number.format(buf, size);
+    else quote(w.widget->getValue().c_str(), buf, size);
+}
+
+// {"id":"x","value":...} with the value last sent
+String RemoteApi::toJson(int i)
+{
+    char json[RemoteWidget::VALUE_SIZE];
+    portENTER_CRITICAL(&_lock);
+    memcpy(json, _widgets[i].json, sizeof(json));
+    portEXIT_CRITICAL(&_lock);
+    String s;
+    s.reserve(32 + RemoteWidget::VALUE_SIZE);
+    s += "{\"id\":\"";
+    s += _widgets[i].id;
+    s += "\",\"value\":";
+    s += json;
+    s += "}";
+    return s;
+}
+
+String RemoteApi::allToJson()
+{
+    String s = "[";
+    for (int i = 0; i < _count; i++)
+    {
+        if (i > 0) s += ",";
+        s += toJson(i);
+    }
+    s += "]";
+    return s;
+}
+
+// A WebSocket message {"id":"x","value":...} writes a widget
+void RemoteApi::handleMessage(const uint8_t *data, size_t len)
+{
+    char msg[96];
+    char id[24];
+    char value[RemoteWidget::VALUE_SIZE];
+    len = min(len, sizeof(msg) - 1);
+    memcpy(msg, data, len);
+    msg[len] = '\0';
+    if (jsonValue(msg, "id", id, sizeof(id)) && jsonValue(msg, "value", value, sizeof(value)))
+    {
+        int code = post(id, value);
+        if (code != 202) log_w("==> Remote write to %s rejected (%d)", id, code);
+    }
+}
+// --- RemoteApi ---
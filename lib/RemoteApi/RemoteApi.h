@@ -0,0 +1,87 @@
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "UiComponents.h"
+#include "UiQueue.h"
+
+#pragma once
+
+// Kind of a registered widget, determines how its value is read and written
+//   FIELD   value field, numeric or text
+//   SLIDER  slider, written values move the knob
+//   LED     LED button, true or false
+enum class RemoteType : uint8_t { FIELD, SLIDER, LED };
+
+struct RemoteWidget
+{
+    static const size_t VALUE_SIZE = 24;
+
+    const char *id;
+    UiButton   *widget;
+    RemoteType  type;
+    bool        isWritable;
+    char        json[VALUE_SIZE];  // value as JSON literal, last sent to the clients
+};
+
+
+/**
+ * Class        RemoteApi
+ * 
+ * Purpose      Exposes registered widgets by id to remote dashboards.
+ *              GET  /api/widgets          all widgets as JSON array
+ *              GET  /api/widget?id=x      one widget {"id":"x","value":...}
+ *              POST /api/widget  id=x&value=v   writes a widget
+ *              ws://<host>/ws             pushes {"id":"x","value":...} for
+ *                                         every change, accepts the same 
+ *                                         object to write a widget
+ *              The widgets are only touched by the UI task. Writes are 
+ *              posted by the web server task to the UI queue, loop() 
+ *              compares the values with the last sent ones and pushes
+ *              only the changed values to the WebSocket clients.
+ * 
+ * Usage        UiQueue uiQueue;
+ *              RemoteApi remoteApi(server, uiQueue);
+ *              remoteApi.addSlider("sliderA", &sliderA);
+ *              remoteApi.addLed("heating", &led1);
+ *              remoteApi.begin();           // when the WLAN is connected
+ *              void loop() { uiQueue.process(); remoteApi.loop(); }
+ * 
+ * Remarks      The ids must be string literals or otherwise outlive the API.
+ *              GET requests are answered from the values last sent, so
+ *              they need no access to the UI.
+ */
+class RemoteApi
+{
+    public:
+        static const uint8_t  MAX_WIDGETS = 16;
+        static const uint32_t MS_PUSH_PERIOD = 100;
+
+        RemoteApi(AsyncWebServer &server, UiQueue &queue, const char *wsPath="/ws") : 
+            _server(server), _queue(queue), _ws(wsPath)
+        {}
+
+        bool addField(const char *id, UiButton *field, bool isWritable=false);
+        bool addSlider(const char *id, UiSlider *slider);
+        bool addLed(const char *id, UiLed *led);
+        void onWrite(Callback cb);
+        void begin();
+        void loop();
+
+    private:
+        bool   add(const char *id, UiButton *widget, RemoteType type, bool isWritable);
+        int    find(const char *id) const;
+        int    post(const char *id, const char *value);
+        void   readValue(const RemoteWidget &w, char *buf, size_t size);
+        String toJson(int i);
+        String allToJson();
+        void   handleMessage(const uint8_t *data, size_t len);
+
+        AsyncWebServer &_server;
+        UiQueue        &_queue;
+        AsyncWebSocket  _ws;
+        bool            _isStarted = false;
+        RemoteWidget    _widgets[MAX_WIDGETS];
+        uint8_t         _count = 0;
+        Callback        _onWrite = nullptr;
+        uint32_t        _msLastPush = 0;
+        portMUX_TYPE    _lock = portMUX_INITIALIZER_UNLOCKED;  // guards the json values
+};
@@ -0,0 +1,290 @@
+#include "SdIndex.h"
+#include "SdListing.h"
+#include <memory>
+
+static const char INDEX_MAGIC[8] = "CYDIDX1";
+static const char *INDEX_TMP = "/.index.tmp";
+static const uint8_t ENTRIES_PER_LOCK = 8;   // entries indexed per lock of the bus
+static_assert(sizeof(SdEntry) == 112, "entries are read by position");
+
+
+// The name of the entry without its directory
+const char *SdEntry::name() const
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static size_t entryOffset(uint32_t i)
+{
+    return sizeof(SdIndexHeader) + i * sizeof(SdEntry);
+}
+
+
+/**
+ * Loads the index header. If there is no index yet, 
+ * it is built in the background.
+ */
+bool SdIndex::begin()
+{
+    if (loadHeader()) 
+    {
+        log_i("==> %lu entries indexed", _header.count);
+        return true;
+    }
+    return rebuild();
+}
+
+// Starts building the index in a task of its own, unless it is being built
+bool SdIndex::rebuild()
+{
+    bool isBuilding = false;
+    if (! _isBuilding.compare_exchange_strong(isBuilding, true)) return false;
+    if (xTaskCreate(buildTask, "sdIndex", 4096, this, 1, nullptr) == pdPASS) return true;
+    _isBuilding = false;
+    return false;
+}
+
+bool SdIndex::isBuilding() const
+{
+    return _isBuilding;
+}
+
+// Number of entries in the index
+uint32_t SdIndex::count() const
+{
+    return _header.count;
+}
+
+/**
+ * Looks up the entries of the directory dir, e.g. "/SCREENSHOTS".
+ * Each component of the path is searched among the entries of its 
+ * parent only. Returns false if the directory is not in the index.
+ */
+bool SdIndex::findDir(const char *dir, uint32_t &first, uint32_t &count)
+{
+    first = 0;
+    count = _header.rootCount;
+    const char *p = dir;
+    while (*p == '/') p++;
+    while (*p)
+    {
+        const char *end = strchr(p, '/');
+        size_t len = end ? end - p : strlen(p);
+        size_t prefix = p - dir + len;           // length of the path up to this component
+        bool isFound = false;
+        SdEntry batch[8];
+        for (uint32_t i = 0; i < count && ! isFound; i += 8)
+        {
+            size_t n = read(first + i, batch, min(count - i, static_cast<uint32_t>(8)));
+            if (n == 0) return false;
+            for (size_t k = 0; k < n && ! isFound; k++)
+            {
+                const SdEntry &e = batch[k];
+                if (e.isDir && strlen(e.path) == prefix && strncmp(e.path, dir, prefix) == 0)
+                {
+                    first = e.first;
+                    count = e.size;
+                    isFound = true;
+                }
+            }
+        }
+        if (! isFound) return false;
+        p += len;
+        while (*p == '/') p++;
+    }
+    return true;
+}
+
+// Reads up to n entries starting at index first, returns the number read
+size_t SdIndex::read(uint32_t first, SdEntry *entries, size_t n)
+{
+    if (first >= _header.count) return 0;
+    n = min(n, static_cast<size_t>(_header.count - first));
+    SpiLock lock(_bus);
+    if (! lock) return 0;
+    File f = SD.open(INDEX_PATH, FILE_READ);
+    if (! f) return 0;
+    f.seek(entryOffset(first));
+    size_t bytes = f.read(reinterpret_cast<uint8_t *>(entries), n * sizeof(SdEntry));
+    f.close();
+    return bytes / sizeof(SdEntry);
+}
+
+// Registers the HTTP endpoints, call it when the WLAN is connected
+void SdIndex::serve(AsyncWebServer &server)
+{
+    // Registered first: the handler of /api/files also takes the URLs below it
+    server.on("/api/files/rebuild", HTTP_GET, [this](AsyncWebServerRequest *request)
+    {
+        bool isStarted = rebuild();
+        request->send(isStarted ? 202 : 409, "application/json", isStarted ? "{\"building\":true}" : "{\"building\":false}");
+    });
+
+    server.on("/api/files", HTTP_GET, [this](AsyncWebServerRequest *request)
+    {
+        String dir = request->hasParam("dir") ? request->getParam("dir")->value() : String("/");
+        uint32_t offset = request->hasParam("offset") ? request->getParam("offset")->value().toInt() : 0;
+        uint32_t limit = request->hasParam("limit") ? request->getParam("limit")->value().toInt() : 50;
+        std::shared_ptr<SdListing> listing = std::make_shared<SdListing>(*this, dir.c_str(), offset, min(limit, static_cast<uint32_t>(MAX_PAGE)));
+        request->send(request->beginChunkedResponse("application/json", 
+            [listing](uint8_t *buffer, size_t maxLen, size_t index) { return listing->fill(buffer, maxLen); }));
+    });
+}
+
+void SdIndex::buildTask(void *arg)
+{
+    SdIndex *index = static_cast<SdIndex *>(arg);
+    uint32_t ms = millis();
+    bool isBuilt = index->build();
+    log_i("==> Index %s, %lu entries in %lu ms", isBuilt ? "built" : "failed", index->_header.count, millis() - ms);
+    index->_isBuilding = false;
+    vTaskDelete(nullptr);
+}
+
+/**
+ * Walks the card breadth first. The entries of the root are appended
+ * to a new index file, then each directory entry is read back from the 
+ * file in turn, its entries are appended and its first entry and count
+ * are written into its own entry. The new index replaces the old one.
+ * If the bus cannot be locked, the build is given up and the old
+ * index stays in use.
+ */
+bool SdIndex::build()
+{
+    SdIndexHeader header = {};
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    File index;
+    {
+        SpiLock lock(_bus);
+        if (! lock) return false;
+        index = SD.open(INDEX_TMP, "w+");
+        if (! index) return false;
+        index.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+    }
+
+    uint32_t count = 0;
+    if (! appendChildren(index, "/", count, header.rootCount)) return abortBuild(index);
+    for (uint32_t i = 0; i < count; i++)   // count grows while the directories are walked
+    {
+        SdEntry e;
+        {
+            SpiLock lock(_bus);
+            if (! lock) return abortBuild(index);
+            index.seek(entryOffset(i));
+            if (index.read(reinterpret_cast<uint8_t *>(&e), sizeof(e)) != sizeof(e)) break;
+        }
+        if (! e.isDir) continue;
+        e.first = count;
+        if (! appendChildren(index, e.path, count, e.size)) return abortBuild(index);
+        SpiLock lock(_bus);
+        if (! lock) return abortBuild(index);
+        index.seek(entryOffset(i));
+        index.write(reinterpret_cast<const uint8_t *>(&e), sizeof(e));
+    }
+
+    time_t now = time(nullptr);
+    header.count = count;
+    header.built = now > 1700000000 ? static_cast<uint32_t>(now) : 0;
+    SpiLock lock(_bus);
+    if (! lock) return abortBuild(index);
+    index.seek(0);
+    index.write(reinterpret_cast<const uint8_t *>(&header), sizeof(header));
+    index.close();
+    SD.remove(INDEX_PATH);
+    if (! SD.rename(INDEX_TMP, INDEX_PATH)) return false;
+    _header = header;
+    return true;
+}
+
+/**
+ * Appends the entries of the directory path, n is set to their number.
+ * The bus is locked for a few entries at a time, so a directory of 
+ * thousands of files does not keep the writers off the card.
+ * Returns false if the bus could not be locked.
+ */
+bool SdIndex::appendChildren(File &index, const char *path, uint32_t &count, uint32_t &n)
+{
+    n = 0;
+    File dir;
+    {
+        SpiLock lock(_bus);
+        if (! lock) return false;
+        dir = SD.open(path, FILE_READ);
+        if (! dir) return true;     // e.g. removed meanwhile, listed empty
+    }
+    SdEntry e = {};
+    bool isDone = false;
+    bool isLocked = true;
+    while (! isDone)
+    {
+        SpiLock lock(_bus);
+        if (! lock)
+        {
+            isLocked = false;
+            break;
+        }
+        index.seek(entryOffset(count + n));
+        for (uint8_t k = 0; k < ENTRIES_PER_LOCK; k++)
+        {
+            File f = dir.openNextFile();
+            if (! f)
+            {
+                isDone = true;
+                break;
+            }
+            const char *p = f.path();
+            if (strcmp(p, INDEX_PATH) != 0 && strcmp(p, INDEX_TMP) != 0)
+            {
+                strlcpy(e.path, p, sizeof(e.path));
+                e.isDir = f.isDirectory();
+                e.size  = e.isDir ? 0 : f.size();
+                e.mtime = f.getLastWrite();
+                e.first = 0;
+                index.write(reinterpret_cast<const uint8_t *>(&e), sizeof(e));
+                n++;
+            }
+            f.close();
+        }
+    }
+    waitBus();      // the directory must not be closed without the bus
+    dir.close();
+    _bus.unlock();
+    count += n;
+    return isLocked;
+}
+
+/**
+ * Removes the temporary index after the bus could not be locked,
+ * the old index stays in use. Always returns false.
+ */
+bool SdIndex::abortBuild(File &index)
+{
+    log_w("==> Index build given up, SD bus busy");
+    waitBus();
+    index.close();
+    SD.remove(INDEX_TMP);
+    _bus.unlock();
+    return false;
+}
+
+// Locks the bus however long it takes, each attempt waits MS_LOCK_TIMEOUT
+void SdIndex::waitBus()
+{
+    while (! _bus.lock()) {}
+}
+
+bool SdIndex::loadHeader()
+{
+    SpiLock lock(_bus);
+    if (! lock) return false;
+    File f = SD.open(INDEX_PATH, FILE_READ);
+    if (! f) return false;
+    SdIndexHeader header;
+    bool isValid = (f.read(reinterpret_cast<uint8_t *>(&header), sizeof(header)) == sizeof(header)
+                    && memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0);
+    f.close();
+    if (isValid) _header = header;
+    return isValid;
+}
+// --- SdIndex ---
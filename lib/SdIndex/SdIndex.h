@@ -0,0 +1,89 @@
+#include <Arduino.h>
+#include <SD.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include "SpiBus.h"
+
+#pragma once
+
+// An entry of the index, 112 bytes. The entries are stored in the order
+// of a breadth-first walk, so the entries of a directory are contiguous.
+struct SdEntry
+{
+    static const size_t PATH_SIZE = 96;
+
+    char     path[PATH_SIZE];   // full path, longer paths are truncated
+    uint32_t size;              // bytes of a file, number of entries of a directory
+    uint32_t mtime;             // UTC seconds of the last write
+    uint32_t first;             // index of the first entry of a directory
+    uint8_t  isDir;
+    uint8_t  reserved[3];
+
+    const char *name() const;
+};
+
+// The start of the index file
+struct SdIndexHeader
+{
+    char     magic[8];          // "CYDIDX1"
+    uint32_t count;             // entries in the index
+    uint32_t rootCount;         // entries of the root directory, the first ones
+    uint32_t built;             // UTC seconds when the index was built
+    uint32_t reserved[3];
+};
+
+
+/**
+ * Class        SdIndex
+ * 
+ * Purpose      Keeps an index of all files and directories on the SD card
+ *              in the file /.index: path, size, time of the last write.
+ *              The card is walked iteratively, breadth first: the entries
+ *              of a directory are appended to the index file, then the 
+ *              directories are taken from the index file in turn. Neither
+ *              recursion nor a list of directories in RAM is needed.
+ *              The index is built by a task of its own, at boot only if 
+ *              it does not exist. Queries read pages of entries from the
+ *              index without walking the card.
+ *              GET /api/files?dir=/SCREENSHOTS&offset=0&limit=50 streams
+ *              a page of a directory as JSON, GET /api/files/rebuild 
+ *              builds the index anew.
+ * 
+ * Usage        SdIndex sdIndex(sdBus);
+ *              sdIndex.begin();         // after initSDCard()
+ *              sdIndex.serve(server);   // when the WLAN is connected
+ *              SdEntry page[10];
+ *              uint32_t first, count;
+ *              if (sdIndex.findDir("/LOG", first, count)) sdIndex.read(first, page, 10);
+ * 
+ * Remarks      Files written later are listed after the next rebuild.
+ *              The old index answers the queries while a new one is built.
+ */
+class SdIndex
+{
+    public:
+        static constexpr const char *INDEX_PATH = "/.index";
+        static const uint16_t MAX_PAGE = 100;
+
+        SdIndex(SpiBus &bus) : _bus(bus) {}
+
+        bool     begin();
+        bool     rebuild();
+        bool     isBuilding() const;
+        uint32_t count() const;
+        bool     findDir(const char *dir, uint32_t &first, uint32_t &count);
+        size_t   read(uint32_t first, SdEntry *entries, size_t n);
+        void     serve(AsyncWebServer &server);
+
+    private:
+        static void buildTask(void *arg);
+        bool     build();
+        bool     appendChildren(File &index, const char *path, uint32_t &count, uint32_t &n);
+        bool     abortBuild(File &index);
+        void     waitBus();
+        bool     loadHeader();
+
+        SpiBus  &_bus;
+        SdIndexHeader _header = {};
+        std::atomic<bool> _isBuilding{false};
+};
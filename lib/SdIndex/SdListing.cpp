@@ -0,0 +1,105 @@
+/**
+ * Class        Implementation of the class methods of SdListing
+ * 
+ * Purpose      Streams a page of a directory listing from the index
+ */
+#include "SdListing.h"
+
+
+SdListing::SdListing(SdIndex &index, const char *dir, uint32_t offset, uint32_t limit) :
+    _index(index), _offset(offset)
+{
+    strlcpy(_dir, dir, sizeof(_dir));
+    _isFound = _index.findDir(_dir, _first, _total);
+    _next = min(offset, _total);
+    _end = min(offset + limit, _total);
+}
+
+/**
+ * Fills buf with the next at most maxLen bytes of the response.
+ * Returns 0 when the listing is complete.
+ */
+size_t SdListing::fill(uint8_t *buf, size_t maxLen)
+{
+    size_t n = 0;
+    while (n < maxLen)
+    {
+        if (_pos == _len)
+        {
+            if (! nextLine()) break;
+            _pos = 0;
+        }
+        size_t k = min(maxLen - n, _len - _pos);
+        memcpy(buf + n, _line + _pos, k);
+        n += k;
+        _pos += k;
+    }
+    return n;
+}
+
+// Copies s as JSON string without its quotes
+static size_t escape(const char *s, char *buf, size_t size)
+{
+    size_t n = 0;
+    for (; *s && n < size - 2; s++)
+    {
+        if (*s == '"' || *s == '\\') buf[n++] = '\\';
+        buf[n++] = *s;
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+// Formats the next piece of the response into _line
+bool SdListing::nextLine()
+{
+    char name[2*SdEntry::PATH_SIZE];
+    switch (_part)
+    {
+        case Part::HEAD:
+            escape(_dir, name, sizeof(name));
+            if (! _isFound)
+            {
+                _len = snprintf(_line, sizeof(_line), "{\"dir\":\"%s\",\"error\":\"not indexed\"}", name);
+                _part = Part::DONE;
+                return true;
+            }
+            _len = snprintf(_line, sizeof(_line), "{\"dir\":\"%s\",\"total\":%lu,\"offset\":%lu,\"entries\":[", 
+                            name, static_cast<unsigned long>(_total), static_cast<unsigned long>(_offset));
+            _part = Part::ENTRIES;
+            return true;
+
+        case Part::ENTRIES:
+            if (_next < _end)
+            {
+                if (_batchPos == _batchLen)
+                {
+                    _batchLen = _index.read(_first + _next, _batch, min(_end - _next, static_cast<uint32_t>(BATCH)));
+                    _batchPos = 0;
+                    if (_batchLen == 0) _end = _next;  // the index has changed
+                }
+                if (_batchPos < _batchLen)
+                {
+                    const SdEntry &e = _batch[_batchPos++];
+                    escape(e.name(), name, sizeof(name));
+                    _len = snprintf(_line, sizeof(_line), "%s{\"name\":\"%s\",\"size\":%lu,\"mtime\":%lu,\"dir\":%s}",
+                                    _next > _offset ? "," : "", name, static_cast<unsigned long>(e.size),
+                                    static_cast<unsigned long>(e.mtime), e.isDir ? "true" : "false");
+                    _len = min(_len, sizeof(_line) - 1);
+                    _next++;
+                    return true;
+                }
+            }
+            _part = Part::TAIL;
+            // fall through
+
+        case Part::TAIL:
+            _len = snprintf(_line, sizeof(_line), "]}");
+            _part = Part::DONE;
+            return true;
+
+        default:
+            return false;
+    }
+}
+// --- SdListing ---
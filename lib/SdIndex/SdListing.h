@@ -0,0 +1,43 @@
+/**
+ * Header       SdListing.h
+ * 
+ * Purpose      Declaration of the class SdListing           
+ */
+
+#include <Arduino.h>
+#include "SdIndex.h"
+
+#pragma once
+
+// Streams a page of a directory from the index as JSON in chunks:
+// {"dir":"/X","total":n,"offset":0,"entries":[{"name":"a.bmp","size":1,"mtime":0,"dir":false},...]}
+// The entries are read from the index file a few at a time, so 
+// neither the page nor the directory is held in RAM.
+class SdListing
+{
+    public:
+        SdListing(SdIndex &index, const char *dir, uint32_t offset, uint32_t limit);
+        size_t fill(uint8_t *buf, size_t maxLen);
+
+    private:
+        enum class Part : uint8_t { HEAD, ENTRIES, TAIL, DONE };
+        static const uint8_t BATCH = 8;
+
+        bool nextLine();
+
+        SdIndex &_index;
+        char     _dir[SdEntry::PATH_SIZE];
+        bool     _isFound;
+        uint32_t _first = 0;       // index of the first entry of the directory
+        uint32_t _total = 0;       // entries of the directory
+        uint32_t _offset;
+        uint32_t _end;             // offset after the last entry of the page
+        uint32_t _next;            // offset of the next entry
+        Part     _part = Part::HEAD;
+        SdEntry  _batch[BATCH];
+        uint8_t  _batchLen = 0;
+        uint8_t  _batchPos = 0;
+        char     _line[192];
+        size_t   _len = 0;
+        size_t   _pos = 0;
+};
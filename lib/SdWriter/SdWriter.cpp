@@ -0,0 +1,176 @@
+#include "SdWriter.h"
+
+
+/**
+ * Allocates the 2 buffers and optionally starts the flush task.
+ * Returns false if the memory is not available.
+ */
+bool SdWriter::begin(bool isBackground, UBaseType_t priority, BaseType_t core)
+{
+    if (_buffers[0] != nullptr) return true;
+    _buffers[0] = static_cast<uint8_t *>(malloc(_bufferSize));  // internal RAM, DMA capable and word aligned
+    _buffers[1] = static_cast<uint8_t *>(malloc(_bufferSize));
+    if (_buffers[0] == nullptr || _buffers[1] == nullptr)
+    {
+        log_e("==> No memory for %u byte buffers", _bufferSize);
+        return false;
+    }
+    if (! isBackground) return true;
+    _idle = xSemaphoreCreateBinary();
+    xSemaphoreGive(_idle);
+    return xTaskCreatePinnedToCore(flushTask, "sdWriter", 3072, this, priority, &_task, core) == pdPASS;
+}
+
+/**
+ * Opens the file. With preallocate > 0 a new file is extended to this
+ * size before writing. Writes are aligned to the sectors of the file.
+ */
+bool SdWriter::open(const char *path, uint32_t preallocate, const char *mode)
+{
+    if (_isOpen) close();
+    if (_buffers[0] == nullptr) return false;
+    SpiLock lock(_bus);
+    if (! lock) return false;
+    _file = SD.open(path, mode, true);
+    if (! _file) 
+    {
+        log_e("==> Cannot open %s", path);
+        return false;
+    }
+    uint32_t start = _file.position();
+    if (preallocate > start)
+    {
+        _file.seek(preallocate - 1);  // FAT allocates the clusters up to here
+        _file.write(static_cast<uint8_t>(0));
+        _file.seek(start);
+    }
+    _fill = 0;
+    _len = 0;
+    _offset = start;
+    _limit = _bufferSize - start % SECTOR_SIZE;
+    _written = 0;
+    _hasError = false;
+    _isOpen = true;
+    return true;
+}
+
+// Continues writing at pos, e.g. after the valid data of a file opened with "r+"
+bool SdWriter::seek(uint32_t pos)
+{
+    if (! _isOpen) return false;
+    flush();
+    SpiLock lock(_bus);
+    if (! lock || ! _file.seek(pos)) return false;
+    _offset = pos;
+    _limit = _bufferSize - pos % SECTOR_SIZE;
+    return true;
+}
+
+// Copies the data to the buffer, full buffers are written
+size_t SdWriter::write(const uint8_t *data, size_t len)
+{
+    if (! _isOpen) return 0;
+    size_t n = 0;
+    while (n < len)
+    {
+        size_t chunk = min(len - n, _limit - _len);
+        memcpy(_buffers[_fill] + _len, data + n, chunk);
+        _len += chunk;
+        n += chunk;
+        if (_len == _limit) queueBuffer();
+    }
+    _written += n;
+    return n;
+}
+
+// Writes the buffered data to the card
+bool SdWriter::flush()
+{
+    if (! _isOpen) return false;
+    if (_len > 0) queueBuffer();
+    waitIdle();
+    SpiLock lock(_bus);
+    if (lock) _file.flush();
+    return ! _hasError;
+}
+
+bool SdWriter::close()
+{
+    if (! _isOpen) return false;
+    flush();
+    {
+        SpiLock lock(_bus);
+        _file.close();
+    }
+    _isOpen = false;
+    return ! _hasError;
+}
+
+bool SdWriter::isOpen() const
+{
+    return _isOpen;
+}
+
+// A block could not be written completely, e.g. the card is full
+bool SdWriter::hasError() const
+{
+    return _hasError;
+}
+
+// Bytes written since the file was opened
+uint32_t SdWriter::written() const
+{
+    return _written;
+}
+
+// Writes the buffer being filled or hands it to the flush task and
+// continues with the other buffer
+void SdWriter::queueBuffer()
+{
+    if (_task == nullptr)
+    {
+        writeBlock(_buffers[_fill], _len);
+    }
+    else
+    {
+        xSemaphoreTake(_idle, portMAX_DELAY);  // the other buffer has been written
+        _pending = _buffers[_fill];
+        _pendingLen = _len;
+        xTaskNotifyGive(_task);
+        _fill ^= 1;
+    }
+    _offset += _len;
+    _len = 0;
+    _limit = _bufferSize - _offset % SECTOR_SIZE;  // realigns after a partial flush
+}
+
+// Waits until the flush task has written the pending buffer
+void SdWriter::waitIdle()
+{
+    if (_task == nullptr) return;
+    xSemaphoreTake(_idle, portMAX_DELAY);
+    xSemaphoreGive(_idle);
+}
+
+bool SdWriter::writeBlock(const uint8_t *data, size_t len)
+{
+    SpiLock lock(_bus);
+    if (! lock || _file.write(data, len) != len)
+    {
+        _hasError = true;
+        return false;
+    }
+    return true;
+}
+
+void SdWriter::flushTask(void *arg)
+{
+    SdWriter *writer = static_cast<SdWriter *>(arg);
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        writer->writeBlock(writer->_pending, writer->_pendingLen);
+        xSemaphoreGive(writer->_idle);
+    }
+}
+// --- SdWriter ---
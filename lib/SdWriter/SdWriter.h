@@ -0,0 +1,76 @@
+#include <Arduino.h>
+#include <SD.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "SpiBus.h"
+
+#pragma once
+
+/**
+ * Class        SdWriter
+ * 
+ * Purpose      Writes a file to the SD card in large sector-aligned blocks.
+ *              Small writes, e.g. the rows of a screenshot or the records 
+ *              of a data logger, are collected in a buffer of some KB. A
+ *              full buffer is written at once, so the card sees whole 
+ *              sectors at sector boundaries instead of many partial ones.
+ *              A file can be preallocated to its final size, which 
+ *              allocates the clusters once instead of cluster by cluster.
+ *              With a background task, a full buffer is handed to the task
+ *              and filled the other buffer meanwhile, so the writing task
+ *              only waits when both buffers are full.
+ * 
+ * Usage        SdWriter sdWriter(sdBus);
+ *              sdWriter.begin();                  // or begin(true) for background flushing
+ *              if (sdWriter.open("/log.bin", 1 << 20))
+ *              {
+ *                  sdWriter.write(record, sizeof(record));
+ *                  sdWriter.close();
+ *              }
+ * 
+ * Remarks      The bus is locked for each block written, not for the whole
+ *              file, so other tasks can use the SD card in between.
+ *              A preallocated file keeps its preallocated size.
+ */
+class SdWriter
+{
+    public:
+        static const size_t SECTOR_SIZE = 512;
+
+        SdWriter(SpiBus &bus, size_t bufferSize=8*SECTOR_SIZE) :
+            _bus(bus), _bufferSize(max(bufferSize / SECTOR_SIZE, static_cast<size_t>(1)) * SECTOR_SIZE)
+        {}
+
+        bool   begin(bool isBackground=false, UBaseType_t priority=1, BaseType_t core=0);
+        bool   open(const char *path, uint32_t preallocate=0, const char *mode=FILE_WRITE);
+        bool   seek(uint32_t pos);
+        size_t write(const uint8_t *data, size_t len);
+        bool   flush();
+        bool   close();
+        bool   isOpen() const;
+        bool   hasError() const;
+        uint32_t written() const;
+
+    private:
+        void   queueBuffer();
+        void   waitIdle();
+        bool   writeBlock(const uint8_t *data, size_t len);
+        static void flushTask(void *arg);
+
+        SpiBus  &_bus;
+        File     _file;
+        size_t   _bufferSize;
+        uint8_t *_buffers[2] = { nullptr, nullptr };
+        uint8_t  _fill = 0;          // buffer being filled
+        size_t   _len = 0;           // bytes in the buffer being filled
+        size_t   _limit = 0;         // flush the buffer at this length, the next sector boundary of the file
+        uint32_t _offset = 0;        // file position of the buffer being filled
+        uint32_t _written = 0;
+        bool     _isOpen = false;
+        bool     _hasError = false;
+        TaskHandle_t      _task = nullptr;
+        SemaphoreHandle_t _idle = nullptr;   // given by the task when the pending buffer is written
+        const uint8_t    *_pending = nullptr;
+        size_t            _pendingLen = 0;
+};
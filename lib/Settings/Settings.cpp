@@ -0,0 +1,446 @@
+#include "Settings.h"
+
+static const size_t MAX_KEY_LEN = 15;   // NVS limit
+
+
+// Registers the keys with their defaults, call it before begin()
+bool Settings::addInt(const char *key, int32_t def)
+{
+    Setting *s = add(key, SettingType::INT, sizeof(int32_t));
+    if (! s) return false;
+    s->def.i = def;
+    setDefault(*s);
+    return true;
+}
+
+bool Settings::addFloat(const char *key, float def)
+{
+    Setting *s = add(key, SettingType::FLOAT, sizeof(float));
+    if (! s) return false;
+    s->def.f = def;
+    setDefault(*s);
+    return true;
+}
+
+bool Settings::addBool(const char *key, bool def)
+{
+    Setting *s = add(key, SettingType::BOOL, sizeof(uint8_t));
+    if (! s) return false;
+    s->def.b = def;
+    setDefault(*s);
+    return true;
+}
+
+bool Settings::addText(const char *key, const char *def, size_t size)
+{
+    Setting *s = add(key, SettingType::TEXT, size);
+    if (! s) return false;
+    s->defText = def;
+    setDefault(*s);
+    return true;
+}
+
+bool Settings::addBytes(const char *key, size_t size)
+{
+    Setting *s = add(key, SettingType::BYTES, size);
+    if (! s) return false;
+    setDefault(*s);
+    return true;
+}
+
+/**
+ * Loads all keys into RAM. Keys not found keep their default.
+ * If the schema version differs, the keys and the version are
+ * written at once and the keys no longer registered are erased.
+ * Returns false if the namespace could not be written.
+ */
+bool Settings::begin()
+{
+    if (! _mutex) _mutex = xSemaphoreCreateMutex();
+    uint16_t version = 0;
+    nvs_handle_t h;
+    if (nvs_open(_ns, NVS_READONLY, &h) == ESP_OK)   // fails if the namespace does not exist yet
+    {
+        nvs_get_u16(h, VERSION_KEY, &version);
+        for (uint8_t i = 0; i < _count; i++) load(h, _settings[i]);
+        nvs_close(h);
+    }
+    if (version == _version) return true;
+
+    log_i("==> %s: schema version %u -> %u", _ns, version, _version);
+    lock();
+    _isPrunePending = true;
+    for (uint8_t i = 0; i < _count; i++) _settings[i].isDirty = true;
+    _isDirty = true;
+    unlock();
+    return commit();
+}
+
+int32_t Settings::getInt(const char *key)
+{
+    lock();
+    Setting *s = find(key, SettingType::INT);
+    int32_t v = s ? s->i : 0;
+    unlock();
+    return v;
+}
+
+float Settings::getFloat(const char *key)
+{
+    lock();
+    Setting *s = find(key, SettingType::FLOAT);
+    float v = s ? s->f : 0.0f;
+    unlock();
+    return v;
+}
+
+bool Settings::getBool(const char *key)
+{
+    lock();
+    Setting *s = find(key, SettingType::BOOL);
+    bool v = s ? s->b : false;
+    unlock();
+    return v;
+}
+
+// Copies the text into buf, returns its length
+size_t Settings::getText(const char *key, char *buf, size_t size)
+{
+    lock();
+    Setting *s = find(key, SettingType::TEXT);
+    size_t n = strlcpy(buf, s ? s->text : "", size);
+    unlock();
+    return min(n, size - 1);
+}
+
+// Copies the bytes into buf, returns their number or 0 if buf is too small
+size_t Settings::getBytes(const char *key, void *buf, size_t size)
+{
+    lock();
+    Setting *s = find(key, SettingType::BYTES);
+    size_t n = (s && s->len <= size) ? s->len : 0;
+    if (n) memcpy(buf, s->bytes, n);
+    unlock();
+    return n;
+}
+
+// The put methods only change the RAM, unchanged values are not written
+bool Settings::putInt(const char *key, int32_t v)
+{
+    lock();
+    Setting *s = find(key, SettingType::INT);
+    if (s && s->i != v)
+    {
+        s->i = v;
+        changed(*s);
+    }
+    unlock();
+    return s != nullptr;
+}
+
+bool Settings::putFloat(const char *key, float v)
+{
+    lock();
+    Setting *s = find(key, SettingType::FLOAT);
+    if (s && s->f != v)
+    {
+        s->f = v;
+        changed(*s);
+    }
+    unlock();
+    return s != nullptr;
+}
+
+bool Settings::putBool(const char *key, bool v)
+{
+    lock();
+    Setting *s = find(key, SettingType::BOOL);
+    if (s && s->b != v)
+    {
+        s->b = v;
+        changed(*s);
+    }
+    unlock();
+    return s != nullptr;
+}
+
+// Texts longer than the capacity of the key are truncated
+bool Settings::putText(const char *key, const char *v)
+{
+    lock();
+    Setting *s = find(key, SettingType::TEXT);
+    if (s && strncmp(s->text, v, s->size - 1) != 0)
+    {
+        strlcpy(s->text, v, s->size);
+        changed(*s);
+    }
+    unlock();
+    return s != nullptr;
+}
+
+bool Settings::putBytes(const char *key, const void *v, size_t size)
+{
+    lock();
+    Setting *s = find(key, SettingType::BYTES);
+    bool isOk = (s && size <= s->size);
+    if (isOk && (s->len != size || memcmp(s->bytes, v, size) != 0))
+    {
+        memcpy(s->bytes, v, size);
+        s->len = size;
+        changed(*s);
+    }
+    unlock();
+    return isOk;
+}
+
+// Sets all keys to their defaults, they are written with the next commit
+void Settings::clear()
+{
+    lock();
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        setDefault(_settings[i]);
+        _settings[i].isDirty = true;
+    }
+    _isPrunePending = true;
+    _isDirty = true;
+    _msDirty = millis();
+    unlock();
+}
+
+/**
+ * Writes the dirty keys with a single NVS commit. After a change
+ * of the schema version the version is written after the keys and
+ * the keys no longer registered are erased last, so a reset in
+ * between never loses a value that is still in use.
+ */
+bool Settings::commit()
+{
+    if (! _isDirty) return true;
+    lock();
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(_ns, NVS_READWRITE, &h);
+    if (err == ESP_OK)
+    {
+        for (uint8_t i = 0; i < _count && err == ESP_OK; i++)
+        {
+            if (_settings[i].isDirty) err = store(h, _settings[i]);
+        }
+        if (_isPrunePending && err == ESP_OK) err = nvs_set_u16(h, VERSION_KEY, _version);
+        if (err == ESP_OK) err = nvs_commit(h);
+        if (_isPrunePending && err == ESP_OK) err = prune(h);
+        nvs_close(h);
+    }
+    if (err == ESP_OK)
+    {
+        for (uint8_t i = 0; i < _count; i++) _settings[i].isDirty = false;
+        _isPrunePending = false;
+        _isDirty = false;
+    }
+    else
+    {
+        log_e("==> %s not written, error 0x%x", _ns, err);
+        _msDirty = millis();    // tried again after the next debounce time
+    }
+    unlock();
+    return err == ESP_OK;
+}
+
+// Commits the changes once no key has changed for MS_DEBOUNCE ms
+void Settings::loop()
+{
+    if (_isDirty && millis() - _msDirty >= MS_DEBOUNCE) commit();
+}
+
+bool Settings::isDirty() const
+{
+    return _isDirty;
+}
+
+uint16_t Settings::version() const
+{
+    return _version;
+}
+
+// Prints the keys with the values held in RAM
+void Settings::print()
+{
+    lock();
+    Serial.printf("%-10s %u\n", VERSION_KEY, _version);
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        const Setting &s = _settings[i];
+        switch (s.type)
+        {
+            case SettingType::INT:   Serial.printf("%-10s %ld\n", s.key, static_cast<long>(s.i)); break;
+            case SettingType::FLOAT: Serial.printf("%-10s %4.2f\n", s.key, s.f); break;
+            case SettingType::BOOL:  Serial.printf("%-10s %s\n", s.key, s.b ? "true" : "false"); break;
+            case SettingType::TEXT:  Serial.printf("%-10s %s\n", s.key, s.text); break;
+            case SettingType::BYTES: Serial.printf("%-10s %u bytes\n", s.key, s.len); break;
+        }
+    }
+    unlock();
+}
+
+Setting *Settings::add(const char *key, SettingType type, size_t size)
+{
+    if (_count >= MAX_KEYS || strlen(key) > MAX_KEY_LEN || size > Setting::MAX_SIZE || size == 0)
+    {
+        log_e("==> %s: key %s not added", _ns, key);
+        return nullptr;
+    }
+    Setting &s = _settings[_count++];
+    s.key  = key;
+    s.type = type;
+    s.size = size;
+    return &s;
+}
+
+// Keys are few, they are found by a linear search
+Setting *Settings::find(const char *key, SettingType type)
+{
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if (_settings[i].type == type && strcmp(_settings[i].key, key) == 0) return &_settings[i];
+    }
+    log_e("==> %s: no key %s of this type", _ns, key);
+    return nullptr;
+}
+
+void Settings::setDefault(Setting &s)
+{
+    memset(s.bytes, 0, sizeof(s.bytes));
+    s.len = 0;
+    switch (s.type)
+    {
+        case SettingType::INT:   s.i = s.def.i; break;
+        case SettingType::FLOAT: s.f = s.def.f; break;
+        case SettingType::BOOL:  s.b = s.def.b; break;
+        case SettingType::TEXT:  strlcpy(s.text, s.defText, s.size); break;
+        case SettingType::BYTES: break;
+    }
+}
+
+void Settings::changed(Setting &s)
+{
+    s.isDirty = true;
+    _isDirty = true;
+    _msDirty = millis();
+}
+
+// Reads a key, it keeps its default if it is missing or of another type
+bool Settings::load(nvs_handle_t h, Setting &s)
+{
+    size_t n = s.size;
+    switch (s.type)
+    {
+        case SettingType::INT:
+            return nvs_get_i32(h, s.key, &s.i) == ESP_OK;
+
+        case SettingType::FLOAT:
+        {
+            float f;
+            if (nvs_get_blob(h, s.key, &f, &n) != ESP_OK || n != sizeof(f)) return false;
+            s.f = f;
+            return true;
+        }
+
+        case SettingType::BOOL:
+        {
+            uint8_t b;
+            if (nvs_get_u8(h, s.key, &b) != ESP_OK) return false;
+            s.b = (b != 0);
+            return true;
+        }
+
+        case SettingType::TEXT:
+        {
+            char text[Setting::MAX_SIZE];
+            if (nvs_get_str(h, s.key, text, &n) != ESP_OK) return false;
+            strlcpy(s.text, text, s.size);
+            return true;
+        }
+
+        case SettingType::BYTES:
+        {
+            uint8_t bytes[Setting::MAX_SIZE];
+            if (nvs_get_blob(h, s.key, bytes, &n) != ESP_OK) return false;
+            memcpy(s.bytes, bytes, n);
+            s.len = n;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Erases the keys of the namespace that are no longer registered.
+ * They are collected first, since erasing a key while iterating
+ * invalidates the iterator.
+ */
+esp_err_t Settings::prune(nvs_handle_t h)
+{
+    static const uint8_t MAX_STALE = 8;
+    char stale[MAX_STALE][MAX_KEY_LEN + 1];
+    uint8_t n;
+    esp_err_t err = ESP_OK;
+    do
+    {
+        n = 0;
+        nvs_iterator_t it = nvs_entry_find(NVS_DEFAULT_PART_NAME, _ns, NVS_TYPE_ANY);
+        while (it && n < MAX_STALE)
+        {
+            nvs_entry_info_t info;
+            nvs_entry_info(it, &info);
+            if (! isRegistered(info.key)) strlcpy(stale[n++], info.key, sizeof(stale[0]));
+            it = nvs_entry_next(it);    // releases the iterator after the last entry
+        }
+        if (it) nvs_release_iterator(it);
+        for (uint8_t i = 0; i < n && err == ESP_OK; i++)
+        {
+            log_i("==> %s: key %s erased", _ns, stale[i]);
+            err = nvs_erase_key(h, stale[i]);
+        }
+    } while (n == MAX_STALE && err == ESP_OK);     // there may be more
+    return err == ESP_OK ? nvs_commit(h) : err;
+}
+
+// The version key counts as registered
+bool Settings::isRegistered(const char *key) const
+{
+    if (strcmp(key, VERSION_KEY) == 0) return true;
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if (strcmp(_settings[i].key, key) == 0) return true;
+    }
+    return false;
+}
+
+esp_err_t Settings::store(nvs_handle_t h, const Setting &s)
+{
+    switch (s.type)
+    {
+        case SettingType::INT:   return nvs_set_i32(h, s.key, s.i);
+        case SettingType::FLOAT: return nvs_set_blob(h, s.key, &s.f, sizeof(s.f));
+        case SettingType::BOOL:  return nvs_set_u8(h, s.key, s.b ? 1 : 0);
+        case SettingType::TEXT:  return nvs_set_str(h, s.key, s.text);
+        case SettingType::BYTES:
+        {
+            if (s.len) return nvs_set_blob(h, s.key, s.bytes, s.len);
+            esp_err_t err = nvs_erase_key(h, s.key);   // no bytes, no key
+            return err == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : err;
+        }
+    }
+    return ESP_OK;
+}
+
+void Settings::lock()
+{
+    if (_mutex) xSemaphoreTake(_mutex, portMAX_DELAY);
+}
+
+void Settings::unlock()
+{
+    if (_mutex) xSemaphoreGive(_mutex);
+}
+// --- Settings ---
@@ -0,0 +1,118 @@
+#include <Arduino.h>
+#include <nvs.h>
+#include <atomic>
+
+#pragma once
+
+enum class SettingType : uint8_t { INT, FLOAT, BOOL, TEXT, BYTES };
+
+// A key of a namespace with its value held in RAM. The values are
+// stored in NVS with the same types as Preferences uses, so entries
+// written by Preferences are read as they are: INT as i32, FLOAT as
+// blob of 4 bytes, BOOL as u8, TEXT as string, BYTES as blob.
+struct Setting
+{
+    static const size_t MAX_SIZE = 68;   // a password of 64 characters fits
+
+    const char *key = nullptr;           // at most 15 characters
+    SettingType type = SettingType::INT;
+    bool     isDirty = false;            // changed since the last commit
+    uint8_t  size = 0;                   // capacity of TEXT and BYTES
+    uint8_t  len = 0;                    // bytes held by BYTES
+    union { int32_t i; float f; bool b; } def = {0};
+    const char *defText = "";
+    union
+    {
+        int32_t i;
+        float   f;
+        bool    b;
+        char    text[MAX_SIZE];
+        uint8_t bytes[MAX_SIZE];
+    };
+};
+
+
+/**
+ * Class        Settings
+ *
+ * Purpose      A typed store of the keys of one NVS namespace. All keys
+ *              are loaded into RAM once by begin(), reads are served from
+ *              RAM. Writes only change the RAM and mark the key dirty;
+ *              loop() writes all dirty keys with a single NVS commit when
+ *              no key has been changed for MS_DEBOUNCE ms. A slider dragged
+ *              across its range thus costs one commit instead of one per
+ *              step, which saves flash wear and keeps the loop fast.
+ *              The namespace carries a schema version in the key VERSION.
+ *              If it differs from the version of the program, all keys
+ *              are written, then VERSION, and only then the keys no longer
+ *              registered are erased, so a reset in between loses nothing:
+ *              keys that kept their name and type keep their value, new
+ *              keys get their default.
+ *
+ * Usage        Settings settings("SETTINGS", 2);
+ *              settings.addInt("STATION", 0);    // before begin()
+ *              settings.addFloat("VOLUME", 0.33f);
+ *              settings.begin();
+ *              float v = settings.getFloat("VOLUME");
+ *              settings.putFloat("VOLUME", 0.5f);
+ *              settings.loop();                  // in loop()
+ *
+ * Remarks      Reads and writes may come from any task. Call commit()
+ *              before a restart, the debounced changes are lost otherwise.
+ */
+class Settings
+{
+    public:
+        static const uint8_t  MAX_KEYS = 8;
+        static const uint32_t MS_DEBOUNCE = 2000;
+        static constexpr const char *VERSION_KEY = "VERSION";
+
+        Settings(const char *ns, uint16_t version) : _ns(ns), _version(version) {}
+
+        bool addInt(const char *key, int32_t def=0);
+        bool addFloat(const char *key, float def=0.0f);
+        bool addBool(const char *key, bool def=false);
+        bool addText(const char *key, const char *def="", size_t size=Setting::MAX_SIZE);
+        bool addBytes(const char *key, size_t size);
+        bool begin();
+
+        int32_t getInt(const char *key);
+        float   getFloat(const char *key);
+        bool    getBool(const char *key);
+        size_t  getText(const char *key, char *buf, size_t size);
+        size_t  getBytes(const char *key, void *buf, size_t size);
+
+        bool putInt(const char *key, int32_t v);
+        bool putFloat(const char *key, float v);
+        bool putBool(const char *key, bool v);
+        bool putText(const char *key, const char *v);
+        bool putBytes(const char *key, const void *v, size_t size);
+
+        void clear();
+        bool commit();
+        void loop();
+        bool isDirty() const;
+        uint16_t version() const;
+        void print();
+
+    private:
+        Setting *add(const char *key, SettingType type, size_t size);
+        Setting *find(const char *key, SettingType type);
+        void     setDefault(Setting &s);
+        void     changed(Setting &s);
+        bool     load(nvs_handle_t h, Setting &s);
+        esp_err_t store(nvs_handle_t h, const Setting &s);
+        esp_err_t prune(nvs_handle_t h);
+        bool     isRegistered(const char *key) const;
+        void     lock();
+        void     unlock();
+
+        const char *_ns;
+        uint16_t _version;
+        Setting  _settings[MAX_KEYS];
+        uint8_t  _count = 0;
+        bool     _isPrunePending = false;   // the schema version has changed or clear() was called
+        std::atomic<bool> _isDirty{false};
+        uint32_t _msDirty = 0;              // time of the last change
+        SemaphoreHandle_t _mutex = nullptr;
+};
@@ -0,0 +1,33 @@
+#include "SpiBus.h"
+
+
+// Starts the host with its pins, the chip selects are driven by the devices
+void SpiBus::begin()
+{
+    if (_mutex != nullptr) return;
+    _mutex = xSemaphoreCreateRecursiveMutex();
+    _spi.begin(_sclk, _miso, _mosi, -1);
+}
+
+SPIClass &SpiBus::spi()
+{
+    return _spi;
+}
+
+/**
+ * Waits up to msTimeout for the bus. Returns false if another 
+ * task holds it longer. Call unlock() after every successful lock.
+ */
+bool SpiBus::lock(uint32_t msTimeout)
+{
+    if (_mutex == nullptr) return false;
+    if (xSemaphoreTakeRecursive(_mutex, pdMS_TO_TICKS(msTimeout)) == pdTRUE) return true;
+    log_w("==> SPI bus busy");
+    return false;
+}
+
+void SpiBus::unlock()
+{
+    xSemaphoreGiveRecursive(_mutex);
+}
+// --- SpiBus ---
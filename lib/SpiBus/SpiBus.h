@@ -0,0 +1,76 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#pragma once
+
+/**
+ * Class        SpiBus
+ * 
+ * Purpose      Owns an SPI host and arbitrates the tasks using the devices
+ *              on it. A task holds the bus with lock() or an SpiLock for 
+ *              a sequence of transactions, e.g. a file write to the SD card,
+ *              other tasks wait up to a timeout. Each device keeps its own
+ *              clock and mode in the SPISettings of its transactions.
+ * 
+ *              The CYD has 3 SPI devices. Each gets its own bus, so none
+ *              has to reconfigure a host shared with another driver:
+ *                LCD       HSPI, owned by LovyanGFX (use_lock, DMA)
+ *                SD card   VSPI, owned by an SpiBus
+ *                Touchpad  pins 25, 32, 39, 33, software SPI of LovyanGFX
+ *              The touchpad used to share VSPI with the SD card, with 
+ *              conflicting pins. Then screenshots came out blank and 
+ *              touch stopped working when the SD card was started.
+ * 
+ * Usage        SpiBus sdBus(VSPI, TF_SCLK, TF_MISO, TF_MOSI);
+ *              sdBus.begin();
+ *              SD.begin(TF_CS, sdBus.spi());
+ *              {
+ *                  SpiLock lock(sdBus);
+ *                  if (lock) file.write(buf, len);
+ *              }
+ * 
+ * Remarks      The lock is recursive, a task holding the bus can lock it again.
+ */
+class SpiBus
+{
+    public:
+        static const uint32_t MS_LOCK_TIMEOUT = 1000;
+
+        SpiBus(uint8_t host, int8_t sclk, int8_t miso, int8_t mosi) :
+            _spi(host), _sclk(sclk), _miso(miso), _mosi(mosi)
+        {}
+
+        void begin();
+        SPIClass &spi();
+        bool lock(uint32_t msTimeout=MS_LOCK_TIMEOUT);
+        void unlock();
+
+    private:
+        SPIClass _spi;
+        int8_t   _sclk;
+        int8_t   _miso;
+        int8_t   _mosi;
+        SemaphoreHandle_t _mutex = nullptr;
+};
+
+
+// Holds the bus for the lifetime of the lock, test it before using the bus
+class SpiLock
+{
+    public:
+        SpiLock(SpiBus &bus, uint32_t msTimeout=SpiBus::MS_LOCK_TIMEOUT) :
+            _bus(bus), _isLocked(bus.lock(msTimeout))
+        {}
+
+        ~SpiLock() { if (_isLocked) _bus.unlock(); }
+        explicit operator bool() const { return _isLocked; }
+
+        SpiLock(const SpiLock &) = delete;
+        SpiLock &operator=(const SpiLock &) = delete;
+
+    private:
+        SpiBus &_bus;
+        bool    _isLocked;
+};
@@ -1,19 +1,24 @@
 #include "UiComponents.h"
 
 
-double fmap(double x, double in_min, double in_max, double out_min, double out_max)
-{
-  double v = (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
-  return fabs(v) < 1.0e-12 ? 0.0 : v;  // prevents exponential representation like -4.0957e-16
-}
-
 //                Text       Background  Border  Shadow  Font
 UiTheme blueTheme(TFT_BLACK, 0x07df,     0x03df, 0x01ca, &fonts::DejaVu12);
 UiTheme defaultTheme;
 
+UiPanel *const *UiPanel::_panels = nullptr;
+uint8_t UiPanel::_panelCount = 0;
+
+UiButton *UiButton::_dirty[UiButton::MAX_DIRTY];
+uint8_t UiButton::_dirtyCount = 0;
+bool UiButton::_inFrame = false;
+
+static const uint8_t DIRTY_VALUE = 0x01;
+static const uint8_t DIRTY_FULL  = 0x02;
+
 
 void UiButton::draw()
 {
+    if (! isVisible()) return;
     _lcd.drawRoundRect(_x+2, _y+2, _w, _h, _r, _theme._shadowColor);
     _lcd.drawRoundRect(_x+1, _y+1, _w, _h, _r, _theme._shadowColor);
     _lcd.fillRoundRect(_x, _y, _w, _h, _r, _theme._borderColor);
@@ -21,7 +26,16 @@ void UiButton::draw()
     _lcd.setTextDatum(textdatum_t::middle_center);
     _lcd.setTextColor(_theme._textColor, _theme._bodyColor);
     _lcd.setFont(_theme._font);
-    _lcd.drawString(_value, _x+_w/2, _y+2+_h/2);
+    if (_number.isNumeric())
+    {
+        char buf[24];
+        _number.format(buf, sizeof(buf));
+        _lcd.drawString(buf, _x+_w/2, _y+2+_h/2);
+    }
+    else
+    {
+        _lcd.drawString(_value, _x+_w/2, _y+2+_h/2);
+    }
     _lcd.setTextDatum(textdatum_t::middle_left);
     _lcd.setTextColor(_theme._textColor, _parent->getPanelColor());
     _lcd.drawString(_label, _x+_w+_d, _y+2+_h/2);
@@ -33,30 +47,66 @@ bool UiButton::touched(int x, int y)
     return (x > _x && x < _x+_w && y > _y && y < _y+_h);
 }
 
+void UiButton::place(const UiRect &r)
+{
+    _x = r.x;
+    _y = r.y;
+    _w = r.w;
+    _h = r.h;
+}
+
+UiRect UiButton::getBounds()
+{
+    return {_x, _y, _w, _h};
+}
+
+// Components of a hidden panel do not draw
+bool UiButton::isVisible()
+{
+    return ! _parent->isHidden();
+}
+
 void UiButton::clearValue()
 {
     _value= "";
+    _number.setType(UiValueType::TEXT);
     draw();
 }
 
 String UiButton::getValue() 
 {
-    return _value;
+    String value;
+    getValue(value);
+    return value;
 }
 
 void UiButton::getValue(String &value) 
 { 
-    value = _value; 
+    if (_number.isNumeric())
+    {
+        char buf[24];
+        _number.format(buf, sizeof(buf));
+        value = buf;
+    }
+    else
+    {
+        value = _value; 
+    }
 }
 
 void UiButton::getValue(int &value) 
 { 
-    value = _value.toInt(); 
+    value = _number.isNumeric() ? _number.toInt() : _value.toInt(); 
 }
 
 void UiButton::getValue(double &value) 
 { 
-    value = _value.toDouble(); 
+    value = _number.isNumeric() ? _number.toDouble() : _value.toDouble(); 
+}
+
+const UiValue &UiButton::getNumber()
+{
+    return _number;
 }
 
 String UiButton::getLabel() 
@@ -66,7 +116,7 @@ String UiButton::getLabel()
 
 bool UiButton::rangeIsInteger() 
 { 
-    return _rangeIsInteger; 
+    return ! _number.isNumeric() || _number.isInteger(); 
 }
 
 bool UiButton::hasSlider() 
@@ -74,7 +124,7 @@ bool UiButton::hasSlider()
     return _pSlider != nullptr; 
 }
 
-UiButton *UiButton::getSlider() 
+UiSlider *UiButton::getSlider() 
 { 
     return _pSlider; 
 }
@@ -82,36 +132,34 @@ UiButton *UiButton::getSlider()
 
 void UiButton::updateValue(String value)
 {
-    _value = value;
-    draw();
+    updateValue(value.c_str());
+}
+
+// A numeric value field parses the text according to its type,
+// e.g. the text entered on the keypad
+void UiButton::updateValue(const char *value)
+{
+    if (! _number.parse(value)) _value = value;
+    invalidate();
 }
 
+// The value is limited to the range, if one is set
 void UiButton::updateValue(int value)
 {
-    char buf[24];
-    if (_minInt!=0 || _maxInt!=0) // a range is set
-    {
-        if (value < _minInt) value = _minInt;  // limit the value to the range
-        if (value > _maxInt) value = _maxInt;
-    }
-    snprintf(buf, sizeof(buf), "%d", value);
-    _value = buf;
-    //log_i("Int value in %d, value out %s", value, _value);
-    draw();
+    _number.set(value);
+    invalidate();
 }
 
 void UiButton::updateValue(double value)
 {
-    char buf[24];
-    if (_minDouble!=0.0 || _maxDouble!=0.0) // a range is set
-    {
-        if (value < _minDouble) value = _minDouble; // limit the value to the range
-        if (value > _maxDouble) value = _maxDouble;
-    }
-    snprintf(buf, sizeof(buf), "%.4g", value);
-    _value = buf;
-    //log_i("Double value in %.4g, value out %s", value, _value);
-    draw();
+    _number.set(value);
+    invalidate();
+}
+
+void UiButton::updateValue(const UiValue &value)
+{
+    _number = value;
+    invalidate();
 }
 
 void UiButton::setLabel(String label)
@@ -122,6 +170,7 @@ void UiButton::setLabel(String label)
 
 void UiButton::clearLabel()
 {
+    if (! isVisible()) return;
     _lcd.setTextColor(_parent->getPanelColor());
     _lcd.drawString(_label, _x+_w+_d, _y+2+_h/2);
     _lcd.setTextColor(_theme._textColor); 
@@ -129,29 +178,96 @@ void UiButton::clearLabel()
 
 void UiButton:: setRange(int min, int max)
 {
-    //log_i("Button setRange int %p", this);
-    _minInt = min;
-    _maxInt = max;
-    _rangeIsInteger = true;
+    _number.setRange(min, max);
 }
 
 void UiButton:: setRange(double min, double max)
 {
-    //log_i("Button setRange double %p", this);
-    _minDouble = min;
-    _maxDouble = max;
-    _rangeIsInteger = false;
+    _number.setRange(min, max);
 }
 
-void UiButton::addSlider(UiButton *btn)
+// Fixed-point range with the given number of decimals
+void UiButton:: setRange(double min, double max, uint8_t decimals)
+{
+    _number.setType(UiValueType::FIXED, decimals);
+    _number.setRange(min, max);
+}
+
+void UiButton::addSlider(UiSlider *btn)
 {
     _pSlider = btn;
 }
+
+void UiButton::drawValue()
+{
+    draw();
+}
+
+// Value changes are collected until endFrame()
+void UiButton::beginFrame()
+{
+    _inFrame = true;
+}
+
+// Draws each component changed since beginFrame() once
+void UiButton::endFrame()
+{
+    _inFrame = false;
+    for (int i = 0; i < _dirtyCount; i++)
+    {
+        UiButton *btn = _dirty[i];
+        uint8_t flags = btn->_dirtyFlags;
+        btn->_dirtyFlags = 0;
+        (flags & DIRTY_FULL) ? btn->draw() : btn->drawValue();
+    }
+    _dirtyCount = 0;
+}
+
+/**
+ * Draws a change marked in this frame at once. Needed by a button
+ * drawn at several places in one frame, like the keys of the keypad,
+ * and by a field which must be seen before the loop goes on.
+ */
+void UiButton::flush()
+{
+    if (_dirtyFlags == 0) return;
+    for (int i = 0; i < _dirtyCount; i++)
+    {
+        if (_dirty[i] == this) 
+        {
+            _dirty[i] = _dirty[--_dirtyCount];
+            break;
+        }
+    }
+    uint8_t flags = _dirtyFlags;
+    _dirtyFlags = 0;
+    (flags & DIRTY_FULL) ? draw() : drawValue();
+}
+
+// Forgets the changes of this frame, the components are redrawn completely
+void UiButton::discardFrame()
+{
+    for (int i = 0; i < _dirtyCount; i++) _dirty[i]->_dirtyFlags = 0;
+    _dirtyCount = 0;
+}
+
+// Outside of a frame or if too many components are dirty, the component is drawn at once
+void UiButton::invalidate(bool isFull)
+{
+    if (! _inFrame || (_dirtyFlags == 0 && _dirtyCount >= MAX_DIRTY))
+    {
+        isFull ? draw() : drawValue();
+        return;
+    }
+    if (_dirtyFlags == 0) _dirty[_dirtyCount++] = this;
+    _dirtyFlags |= isFull ? DIRTY_FULL : DIRTY_VALUE;
+}
 // --- UiButton ---
 
 
 void UiLed::draw()
 {
+    if (! isVisible()) return;
     _lcd.fillCircle(_x+2, _y+2, _radius, _theme._shadowColor);
     _lcd.fillCircle(_x, _y, _radius, _theme._borderColor);
     _isOn ? _lcd.fillCircle(_x, _y, _radius-2, _color) : _lcd.fillCircle(_x, _y, _radius-2, _theme._bodyColor);
@@ -166,6 +282,13 @@ bool UiLed::touched(int x, int y)
     return (x > _x-_radius && x < _x+_radius && y > _y-_radius && y < _y+_radius);
 }
 
+// The LED is placed at the left side of r, vertically centered
+void UiLed::place(const UiRect &r)
+{
+    _x = r.x + _radius;
+    _y = r.y + r.h/2;
+}
+
 void UiLed::setLabel(String txt)
 {
     _label = txt;
@@ -181,7 +304,7 @@ void UiLed::on()
 {
     if (! _isOn)
     {
-        _lcd.fillCircle(_x, _y, _radius-2, _color);
+        if (isVisible()) _lcd.fillCircle(_x, _y, _radius-2, _color);
         _isOn = true;
     }
 }  
@@ -190,115 +313,535 @@ void UiLed::off()
 {
     if (_isOn)
     {
-        _lcd.fillCircle(_x, _y, _radius-2, _theme._bodyColor);
+        if (isVisible()) _lcd.fillCircle(_x, _y, _radius-2, _theme._bodyColor);
         _isOn = false;
     }
 } 
     
 void UiLed::toggle()
 {
-    if (_isOn)
-    {
-        _lcd.fillCircle(_x, _y, _radius-2, _theme._bodyColor);
-        _isOn = false;
-    }
-    else
-    {
-        _lcd.fillCircle(_x, _y, _radius-2, _color);
-        _isOn = true;
-    }
+    _isOn ? off() : on();
+}
+
+// Changes the color of the LED, a LED that is on is repainted
+void UiLed::setColor(int color)
+{
+    if (color == _color) return;
+    _color = color;
+    if (_isOn && isVisible()) _lcd.fillCircle(_x, _y, _radius-2, _color);
 }
 // --- UiLed ---
 
 
-void UiHslider::draw()
+// Moves the knob to the pixel coordinate c along the track and sets 
+// the value at this position. The knob snaps to the position of the 
+// resulting value.
+void UiSlider::slideToPosition(int c)
 {
-    _lcd.drawRoundRect(_x+2, _y+2, _w, _h, _r, _theme._shadowColor);
-    _lcd.drawRoundRect(_x+1, _y+1, _w, _h, _r, _theme._shadowColor);
-    _lcd.fillRoundRect(_x, _y, _w, _h, _r, _theme._borderColor);
-    _lcd.fillRoundRect(_x+2, _y+2, _w-4, _h-4, _r, _theme._bodyColor);
-    _lcd.fillCircle(_position, _y+_h/2, _rb, _color);
-    _lcd.drawCircle(_position, _y+_h/2, _rb, _theme._borderColor);
-    _lcd.setTextDatum(textdatum_t::middle_left);
-    _lcd.setTextColor(_theme._textColor, _parent->getPanelColor());
-    _lcd.setFont(_theme._font);
-    _lcd.drawString(_label, _x+_w+_d, _y+2+_h/2);    
+    if (isVisible()) eraseKnob();
+    _number.setUnits(_scale.toValue(toKnob(c)));
+    _knob = _scale.toPosition(_number.units());
+    updateValueField();
+    invalidate(true); 
 }
 
-void UiHslider::slideToPosition(int x)
+void UiSlider::slideToValue(int v)
 {
-    _lcd.fillCircle(_position, _y+_h/2, _h, _parent->getPanelColor());
-    _position = x;
-    if (rangeIsInteger())
-    {
-        int v = map(_position-_x, 0, _w-2*_r, _minInt, _maxInt);
-        if (_pValueField) getValueField()->updateValue(v);
-        //log_i("Int x=%d, _w=%d, v=%d, min=%d, max=%d", x, _w, v, _minInt, _maxInt);
-        _value = String(v);
-    }
-    else
-    {
-        double v = fmap(_position-_x, 0.0, _w-2*_r, _minDouble, _maxDouble);
-        if (_pValueField) getValueField()->updateValue(v);
-        //log_i("Double x=%d, w=%d, v=%.10g, min=%.10g, max=%.10g", x, _w, v, _minDouble, _maxDouble);
-        _value = String(v);
-    }
-    
-    draw(); 
+    _number.set(v);
+    slideToNumber();
+}
+
+void UiSlider::slideToValue(double v)
+{
+    _number.set(v);
+    slideToNumber();
 }
 
-void UiHslider::slideToValue(int v)
+void UiSlider::slideToValue(const UiValue &v)
 {
-    _lcd.fillCircle(_position, _y+_h/2, _h, _parent->getPanelColor());
-    _position = map(v, _minInt, _maxInt, 0, _w-2*_r) + _x;
-    if (_pValueField) _pValueField->updateValue(v);
-    _value = String(v);
-    draw(); 
+    _number = v;
+    updateScale();
+    slideToNumber();
 }
 
-void UiHslider::slideToValue(double v)
+// Moves the knob to the position of the current value
+void UiSlider::slideToNumber()
 {
-    _lcd.fillCircle(_position, _y+_h/2, _h, _parent->getPanelColor());
-    _position = fmap(v, _minDouble, _maxDouble, 0, _w) + _x;
-    char buf[24];
-    snprintf(buf,sizeof(buf), "%.4g", v);
-    if (_pValueField) _pValueField->updateValue(buf);
-    _value = buf;
-    draw(); 
+    if (isVisible()) eraseKnob();
+    if (_number.hasRange()) _knob = _scale.toPosition(_number.units());
+    updateValueField();
+    invalidate(true); 
 }
 
-void UiHslider::addValueField(UiButton *btn)
+// Recomputes the mapping between knob positions and values,
+// called when the range, the scale or the track length changes
+void UiSlider::updateScale()
+{
+    _scale.update(_number.unitsMin(), _number.unitsMax(), trackLength());
+}
+
+void UiSlider::setScale(UiScaleType type, uint16_t steps)
+{
+    _scale.setType(type, steps);
+    updateScale();
+    if (_number.hasRange()) slideToNumber();
+}
+
+// The linked value field shows the value of the slider
+void UiSlider::updateValueField()
+{
+    if (_pValueField) _pValueField->updateValue(_number);
+}
+
+void UiSlider::addValueField(UiButton *btn)
 {
     _pValueField = btn;
     _pValueField->addSlider(this);
     //log_i("valueField=%p, slider=%p", _pValueField, this);
 }
 
-bool UiHslider::hasValueField() 
+bool UiSlider::hasValueField() 
 { 
     return _pValueField != nullptr; 
 }
 
-UiButton *UiHslider::getValueField() 
+UiButton *UiSlider::getValueField() 
 { 
     return _pValueField ? _pValueField : nullptr; 
 }
 
-void UiHslider::setRange(int min, int max)
+void UiSlider::setRange(int min, int max)
 {
     //log_i("Slider setRange int vf %p", _pValueField);
     if (_pValueField) _pValueField->setRange(min, max);
     UiButton::setRange(min, max);
+    updateScale();
 }
-void UiHslider::setRange(double min, double max)
+void UiSlider::setRange(double min, double max)
 {
     //log_i("Slider setRange double vf %p", _pValueField);
     if (_pValueField) _pValueField->setRange(min, max);
     UiButton::setRange(min, max);
+    updateScale();
+}
+
+void UiSlider::setRange(double min, double max, uint8_t decimals)
+{
+    if (_pValueField) _pValueField->setRange(min, max, decimals);
+    UiButton::setRange(min, max, decimals);
+    updateScale();
+}
+// --- UiSlider ---
+
+
+// The knob travels from _x+_r to _x+_w-_r
+void UiHslider::draw()
+{
+    if (! isVisible()) return;
+    int kx = _x + _r + _knob;
+    _lcd.drawRoundRect(_x+2, _y+2, _w, _h, _r, _theme._shadowColor);
+    _lcd.drawRoundRect(_x+1, _y+1, _w, _h, _r, _theme._shadowColor);
+    _lcd.fillRoundRect(_x, _y, _w, _h, _r, _theme._borderColor);
+    _lcd.fillRoundRect(_x+2, _y+2, _w-4, _h-4, _r, _theme._bodyColor);
+    _lcd.fillCircle(kx, _y+_h/2, _rb, _color);
+    _lcd.drawCircle(kx, _y+_h/2, _rb, _theme._borderColor);
+    _lcd.setTextDatum(textdatum_t::middle_left);
+    _lcd.setTextColor(_theme._textColor, _parent->getPanelColor());
+    _lcd.setFont(_theme._font);
+    _lcd.drawString(_label, _x+_w+_d, _y+2+_h/2);    
+}
+
+// The slider takes the width of r and keeps its height.
+// The knob keeps its value.
+void UiHslider::place(const UiRect &r)
+{
+    _x = r.x;
+    _y = r.y + (r.h - _h)/2;
+    _w = r.w;
+    updateScale();
+    _knob = _number.hasRange() ? _scale.toPosition(_number.units()) : trackLength()/2;
+}
+
+int UiHslider::trackLength()
+{
+    return _w - 2*_r;
+}
+
+int UiHslider::toKnob(int c)
+{
+    return c - _x - _r;
+}
+
+void UiHslider::eraseKnob()
+{
+    _lcd.fillCircle(_x + _r + _knob, _y+_h/2, _h, _parent->getPanelColor());
 }
 // ---UiHslider ---
 
 
+// The knob travels from _y+_h-_r up to _y+_r
+void UiVslider::draw()
+{
+    if (! isVisible()) return;
+    int ky = _y + _h - _r - _knob;
+    _lcd.drawRoundRect(_x+2, _y+2, _w, _h, _r, _theme._shadowColor);
+    _lcd.drawRoundRect(_x+1, _y+1, _w, _h, _r, _theme._shadowColor);
+    _lcd.fillRoundRect(_x, _y, _w, _h, _r, _theme._borderColor);
+    _lcd.fillRoundRect(_x+2, _y+2, _w-4, _h-4, _r, _theme._bodyColor);
+    _lcd.fillCircle(_x+_w/2, ky, _rb, _color);
+    _lcd.drawCircle(_x+_w/2, ky, _rb, _theme._borderColor);
+    _lcd.setTextDatum(textdatum_t::top_center);
+    _lcd.setTextColor(_theme._textColor, _parent->getPanelColor());
+    _lcd.setFont(_theme._font);
+    _lcd.drawString(_label, _x+_w/2, _y+_h+_d);    
+}
+
+// The slider takes the height of r and keeps its width.
+// The knob keeps its value.
+void UiVslider::place(const UiRect &r)
+{
+    _x = r.x + (r.w - _w)/2;
+    _y = r.y;
+    _h = r.h;
+    updateScale();
+    _knob = _number.hasRange() ? _scale.toPosition(_number.units()) : trackLength()/2;
+}
+
+int UiVslider::trackLength()
+{
+    return _h - 2*_r;
+}
+
+int UiVslider::toKnob(int c)
+{
+    return _y + _h - _r - c;
+}
+
+void UiVslider::eraseKnob()
+{
+    _lcd.fillCircle(_x+_w/2, _y + _h - _r - _knob, _w, _parent->getPanelColor());
+}
+// --- UiVslider ---
+
+
+void UiBar::draw()
+{
+    if (! isVisible()) return;
+    _lcd.drawRect(_x+1, _y+1, _w, _h, _theme._shadowColor);
+    _lcd.drawRect(_x, _y, _w, _h, _theme._borderColor);
+    _level = _scale.toPosition(_number.units());
+    fillBand(0, _level, _color);
+    fillBand(_level, _scale.span(), _theme._bodyColor);
+    _lcd.setTextDatum(textdatum_t::middle_left);
+    _lcd.setTextColor(_theme._textColor, _parent->getPanelColor());
+    _lcd.setFont(_theme._font);
+    _lcd.drawString(_label, _x+_w+_d, _y+_h/2);
+}
+
+// Only the band between the old and the new level is redrawn
+void UiBar::drawValue()
+{
+    if (! isVisible()) return;
+    int level = _scale.toPosition(_number.units());
+    if (level > _level) fillBand(_level, level, _color);
+    else if (level < _level) fillBand(level, _level, _theme._bodyColor);
+    _level = level;
+}
+
+// Fills the pixels from..to-1 of the inner bar, 
+// counted from the left or from the bottom
+void UiBar::fillBand(int from, int to, int color)
+{
+    if (to <= from) return;
+    if (_orientation == UiOrientation::HORIZONTAL)
+        _lcd.fillRect(_x+1+from, _y+1, to-from, _h-2, color);
+    else
+        _lcd.fillRect(_x+1, _y+_h-1-to, _w-2, to-from, color);
+}
+
+void UiBar::place(const UiRect &r)
+{
+    UiButton::place(r);
+    updateScale();
+}
+
+// A bar is an indicator only
+bool UiBar::touched(int x, int y)
+{
+    return false;
+}
+
+void UiBar::setRange(int min, int max)
+{
+    UiButton::setRange(min, max);
+    updateScale();
+}
+
+void UiBar::setRange(double min, double max)
+{
+    UiButton::setRange(min, max);
+    updateScale();
+}
+
+void UiBar::setScale(UiScaleType type, uint16_t steps)
+{
+    _scale.setType(type, steps);
+    updateScale();
+}
+
+void UiBar::updateScale()
+{
+    int span = (_orientation == UiOrientation::HORIZONTAL) ? _w-2 : _h-2;
+    _scale.update(_number.unitsMin(), _number.unitsMax(), span);
+}
+// --- UiBar ---
+
+
+// The meter is drawn into the square _x,_y,_w,_w. 
+// The arc runs clockwise from 135 to 405 degrees.
+void UiArcMeter::draw()
+{
+    if (! isVisible()) return;
+    int r = _w/2;
+    _lcd.fillCircle(_x+r, _y+r, r, _theme._bodyColor);
+    _lcd.drawCircle(_x+r, _y+r, r, _theme._borderColor);
+    _angle = _scale.toPosition(_number.units());
+    fillSegment(0, _angle, _color);
+    fillSegment(_angle, SWEEP, _theme._shadowColor);
+    _text[0] = '\0';
+    drawText();
+    _lcd.setTextDatum(textdatum_t::bottom_center);
+    _lcd.setTextColor(_theme._textColor, _theme._bodyColor);
+    _lcd.setFont(_theme._font);
+    _lcd.drawString(_label, _x+r, _y+_w-2);
+}
+
+// Only the segment between the old and the new angle is redrawn
+void UiArcMeter::drawValue()
+{
+    if (! isVisible()) return;
+    int angle = _scale.toPosition(_number.units());
+    if (angle > _angle) fillSegment(_angle, angle, _color);
+    else if (angle < _angle) fillSegment(angle, _angle, _theme._shadowColor);
+    _angle = angle;
+    drawText();
+}
+
+void UiArcMeter::fillSegment(int from, int to, int color)
+{
+    if (to <= from) return;
+    int r = _w/2;
+    _lcd.fillArc(_x+r, _y+r, r-3, r-3-r/4, 135+from, 135+to, color);
+}
+
+// The value text is redrawn only if it has changed
+void UiArcMeter::drawText()
+{
+    char text[sizeof(_text)];
+    _number.format(text, sizeof(text));
+    if (strcmp(text, _text) == 0) return;
+    int r = _w/2;
+    _lcd.setTextDatum(textdatum_t::middle_center);
+    _lcd.setTextColor(_theme._textColor, _theme._bodyColor);
+    _lcd.setFont(_theme._font);
+    _lcd.setTextPadding(r);
+    _lcd.drawString(text, _x+r, _y+r);
+    _lcd.setTextPadding(0);
+    strcpy(_text, text);
+}
+
+// The meter takes the largest square centered in r
+void UiArcMeter::place(const UiRect &r)
+{
+    int size = min(r.w, r.h);
+    UiButton::place(r.centered(size, size));
+    updateScale();
+}
+
+// A meter is an indicator only
+bool UiArcMeter::touched(int x, int y)
+{
+    return false;
+}
+
+void UiArcMeter::setRange(int min, int max)
+{
+    UiButton::setRange(min, max);
+    updateScale();
+}
+
+void UiArcMeter::setRange(double min, double max)
+{
+    UiButton::setRange(min, max);
+    updateScale();
+}
+
+void UiArcMeter::setRange(double min, double max, uint8_t decimals)
+{
+    UiButton::setRange(min, max, decimals);
+    updateScale();
+}
+
+// One knob position per degree
+void UiArcMeter::updateScale()
+{
+    _scale.update(_number.unitsMin(), _number.unitsMax(), SWEEP);
+}
+// --- UiArcMeter ---
+
+
+// The border is drawn directly, the plot area inside it is the sprite
+void UiChart::draw()
+{
+    if (! isVisible()) return;
+    _lcd.drawRect(_x+1, _y+1, _w, _h, _theme._shadowColor);
+    _lcd.drawRect(_x, _y, _w, _h, _theme._borderColor);
+    if (! createPlot()) return;
+    _plot.fillScreen(_theme._bodyColor);
+    if (_history && _window > 0)
+    {
+        drawEnvelope();
+        return;
+    }
+    int n = min(_count, _w-2);
+    int i = (_head - n + MAX_SAMPLES) % MAX_SAMPLES;
+    int x = _w-2 - n;
+    float v0 = _samples[i];
+    for (; n > 0; n--, x++)
+    {
+        drawColumn(x, v0, _samples[i]);
+        v0 = _samples[i];
+        i = (i + 1) % MAX_SAMPLES;
+    }
+    _plot.pushSprite(_x+1, _y+1);
+}
+
+// Appends the sample. A visible chart is scrolled left by 
+// one pixel and only the column of the new sample is drawn.
+void UiChart::addSample(float v)
+{
+    float v0 = _count > 0 ? _samples[(_head - 1 + MAX_SAMPLES) % MAX_SAMPLES] : v;
+    _samples[_head] = v;
+    _head = (_head + 1) % MAX_SAMPLES;
+    if (_count < MAX_SAMPLES) _count++;
+    if (_history) _history->add(v);
+
+    if (! isVisible() || ! createPlot()) return;
+    if (_history && _window > 0)
+    {
+        _plot.fillScreen(_theme._bodyColor);
+        drawEnvelope();
+        return;
+    }
+    _plot.scroll(-1, 0);
+    drawColumn(_w-3, v0, v);
+    _plot.pushSprite(_x+1, _y+1);
+}
+
+// Connects the previous sample v0 in column x-1 with v in column x
+void UiChart::drawColumn(int x, float v0, float v)
+{
+    int y0 = toY(v0);
+    int y1 = toY(v);
+    _plot.drawFastVLine(x, min(y0, y1), abs(y1 - y0) + 1, _color);
+}
+
+// Draws the min/max envelope of the window, one column per pixel
+void UiChart::drawEnvelope()
+{
+    int columns = _w-2;
+    UiMinMax env;
+    for (int c = 0; c < columns; c++)
+    {
+        if (! _history->column(_window, columns, c, env)) continue;
+        drawColumn(c, env.min, env.max);
+    }
+    _plot.pushSprite(_x+1, _y+1);
+}
+
+// The row of the value, the minimum is at the bottom
+int UiChart::toY(float v)
+{
+    return _scale.span() - _scale.toPosition(v);
+}
+
+// Creates the sprite of the plot area if it does not exist or 
+// has the wrong size. Returns false if the memory is insufficient.
+bool UiChart::createPlot()
+{
+    if (_plot.width() == _w-2 && _plot.height() == _h-2) return true;
+    _plot.deleteSprite();
+    if (_plot.createSprite(_w-2, _h-2) == nullptr) return false;
+    _plot.setBaseColor(_theme._bodyColor);  // color of the column scrolled in
+    return true;
+}
+
+// The chart takes r. The sprite is recreated on the next draw.
+void UiChart::place(const UiRect &r)
+{
+    UiButton::place(r);
+    _scale.update(_scale.lower(), _scale.upper(), _h-3);
+}
+
+// A chart is an indicator only
+bool UiChart::touched(int x, int y)
+{
+    return false;
+}
+
+void UiChart::setRange(int min, int max)
+{
+    setRange(static_cast<double>(min), static_cast<double>(max));
+}
+
+// Sets the range of the vertical axis. Samples outside are clipped.
+void UiChart::setRange(double min, double max)
+{
+    _scale.update(min, max, _h-3);
+    draw();
+}
+
+void UiChart::clear()
+{
+    _head = 0;
+    _count = 0;
+    if (_history) _history->clear();
+    draw();
+}
+
+int UiChart::sampleCount()
+{
+    return _count;
+}
+
+// The samples added from now on are also fed into the history
+void UiChart::setHistory(UiMinMaxPyramid *history)
+{
+    _history = history;
+}
+
+// Shows the envelope of the latest samples of the history, 
+// or the samples of the ring buffer if samples is 0
+void UiChart::setWindow(uint32_t samples)
+{
+    _window = samples;
+    draw();
+}
+
+uint32_t UiChart::getWindow()
+{
+    return _window;
+}
+// --- UiChart ---
+
+
+// The changes pending in this frame are drawn by the panels
+void UiPanel::redrawPanels()
+{
+    UiButton::discardFrame();
+    for (int i = 0; i < _panelCount; i++) _panels[i]->show();
+}
+
 void UiPanel::show()
 {
     _lcd.fillRect(_x,_y,_w,_h,_bgColor);
@@ -311,12 +854,30 @@ void UiPanel::hide(UiPanel *pCaller)
     pCaller == nullptr ? _lcd.fillRect(_x,_y,_w,_h,_lcd.getBaseColor()) : pCaller->show();
 }
 
+/**
+ * Moves and resizes the panel and lets the derived
+ * panel place its components in the new bounds
+ */
+void UiPanel::setBounds(const UiRect &r)
+{
+    _x = r.x;
+    _y = r.y;
+    _w = r.w;
+    _h = r.h;
+    layout();
+}
+
+UiRect UiPanel::getBounds()
+{
+    return {_x, _y, _w, _h};
+}
+
 bool UiPanel::isHidden()
 {
     return _hidden;
 }
 
-void UiPanel::addKeypad(UiKeypad *pKeypad)
+void UiPanel::addKeypad(UiKeypadBase *pKeypad)
 {
     _pKeypad = pKeypad;
 }
@@ -341,108 +902,131 @@ void UiPanel::panelText(int x, int y, String text, int textColor, GFXfont font)
 // --- UiPanel ---
 
 
-void UiKeypad::show()
+void UiKeypadBase::drawKey(const UiRect &r, const UiKeyDef &key)
+{
+    if (key.role == UiKeyRole::NONE) return;
+    _key.place(r);
+    _key.updateValue(key.caption);
+    _key.flush();   // the one scratch button is drawn at each key
+}
+
+void UiKeypadBase::clearEntry()
 {
-    UiPanel::show();
-    _btnEntry->clearValue();
-    for (int i = 0; i < _btns.size(); i++) { _btns.at(i)->draw(); }
+    _len = 0;
+    _text[0] = '\0';
+    showEntry();
 }
 
-void UiKeypad::handleKeys(int x, int y)
+void UiKeypadBase::showEntry()
+{
+    if (_masked)
+    {
+        char mask[_maxLen + 1];
+        memset(mask, '*', _len);
+        mask[_len] = '\0';
+        _entryField.updateValue(mask);
+    }
+    else
+    {
+        _entryField.updateValue(_text);
+    }
+    _entryField.flush();   // shown before the key delay
+}
+
+/**
+ * Edits the entry text according to the role of the tapped key
+ */
+void UiKeypadBase::handleKey(const UiKeyDef &key)
 {
     int msKeyDelay = 300;
-    for (int i = 1; i < _btns.size(); i++)
+    char *e = strpbrk(_text, "Ee"); // start of the exponent
+    Serial.printf("Key pressed: %s\n", key.caption);
+    switch (key.role)
     {
-        if (_btns.at(i)->touched(x, y))
-        {
-            String keyValue = _btns.at(i)->getValue();
-            Serial.printf("Key pressed: %s\n", keyValue);
-            if (i > 0 && i < 12) // handle digits and decimal point
-            {
-                if (_btns.at(i)->getValue() == "." && _btnEntry->getValue().indexOf('.') > 0) return;
-                String newValue = _btnEntry->getValue() + _btns.at(i)->getValue();
-                _btnEntry->updateValue(newValue);
-                delay(msKeyDelay);
-                return;
-            }
+        case UiKeyRole::NONE:
+            return;
+
+        case UiKeyRole::DOT: // only one decimal point, not in the exponent
+            if (strchr(_text, '.') != nullptr || e != nullptr) return;
+            // fall through
+        case UiKeyRole::DIGIT:
+            if (_len >= _maxLen) return;
+            _text[_len++] = key.caption[0];
+            _text[_len] = '\0';
+        break;
 
-            if (keyValue == "Clr") 
-                { 
-                    _btnEntry->updateValue(""); 
-                    return; 
-                }
-            if (keyValue == "C") 
-                { 
-                    _btnEntry->updateValue(_btnEntry->getValue().substring(0, _btnEntry->getValue().length()-1));
-                    delay(msKeyDelay); 
-                    return; 
-                }
-            if (keyValue =="+/-")
-                { 
-                    if (_btnEntry->getValue().length() > 0)
-                    {
-                        if (_btnEntry->getValue().indexOf('.') > 0) // it's a float
-                        {
-                            double v = _btnEntry->getValue().toDouble();
-                            if (v != 0) v = -v;
-                            _btnEntry->updateValue(v);
-                        }
-                        else
-                        {
-                            int v = _btnEntry->getValue().toInt(); // it's an integer
-                            v = -v;
-                            //log_i("int %d", v);
-                            _btnEntry->updateValue(v);
-                        }
-                        delay(msKeyDelay);
-                        return; 
-                    }  
-                }
-            if (keyValue == "X")
+        case UiKeyRole::EXP: // only one exponent, after at least one digit
+            if (e != nullptr || _len == 0 || _len >= _maxLen) return;
+            _text[_len++] = 'E';
+            _text[_len] = '\0';
+        break;
+
+        case UiKeyRole::SIGN: // toggles the sign of the exponent if there is one, else of the mantissa
+        {
+            char *p = e ? e + 1 : _text;
+            if (*p == '-') 
             {
-                delay(msKeyDelay);
-                //log_e("==> done X");
-                hide();
-                UiPanel::redrawPanels(); // Called to restore underlying panels 
-                return;
+                memmove(p, p + 1, strlen(p));
+                _len--;
             }
-            if (keyValue == "OK")
+            else if (_len < _maxLen)
             {
-                delay(msKeyDelay);
-                String e = _btnEntry->getValue();
-                if (!_targetValueField->rangeIsInteger()) // The assigned value field contains floats
-                {
-                    double v = e.toDouble();
-                    _targetValueField->updateValue(v);
-                    _targetValueField->getValue(v);
-                    //log_e("==> done OK: targetValueField=%p, slider=%p", _targetValueField, this);
-                    if (_targetValueField->hasSlider()) reinterpret_cast<UiHslider *>(_targetValueField->getSlider())->slideToValue(v);
-                }
-                else
-                {
-                    int v = e.toInt();                    // The assigned value field contains integers
-                    _targetValueField->updateValue(v);
-                    _targetValueField->getValue(v);
-                    //log_e("==> done OK: targetValueField=%p, slider=%p", _targetValueField, this);
-                    if (_targetValueField->hasSlider()) reinterpret_cast<UiHslider *>(_targetValueField->getSlider())->slideToValue(v);
-                } 
-                       
-                hide();
-                if (_okCallback != nullptr) _okCallback(_targetValueField);
-                UiPanel::redrawPanels(); // Called to restore underlying panels
-                return;                
+                memmove(p + 1, p, strlen(p) + 1);
+                *p = '-';
+                _len++;
             }
         }
-    }    
+        break;
+
+        case UiKeyRole::BACK:
+            if (_len > 0) _text[--_len] = '\0';
+        break;
+
+        case UiKeyRole::CLEAR:
+            clearEntry();
+        return;
+
+        case UiKeyRole::CANCEL:
+            delay(msKeyDelay);
+            hide();
+            UiPanel::redrawPanels(); // Called to restore underlying panels 
+        return;
+
+        case UiKeyRole::OK:
+            delay(msKeyDelay);
+            acceptEntry();
+        return;
+    }
+    showEntry();
+    delay(msKeyDelay);
+}
+
+/**
+ * Passes the entered value to the target value field and 
+ * its slider, closes the keypad and calls the OK callback
+ */
+void UiKeypadBase::acceptEntry()
+{
+    if (_targetValueField != nullptr)
+    {
+        if (_entry == UiEntry::HEX)
+            _targetValueField->updateValue(static_cast<int>(strtol(_text, nullptr, 16)));
+        else
+            _targetValueField->updateValue(_text);  // parsed according to the type of the value field
+        if (_targetValueField->hasSlider()) _targetValueField->getSlider()->slideToValue(_targetValueField->getNumber());
+    }
+    hide();
+    if (_okCallback != nullptr) _okCallback(_targetValueField);
+    UiPanel::redrawPanels(); // Called to restore underlying panels
 }
 
-void UiKeypad::addValueField(UiButton *btn) 
+void UiKeypadBase::addValueField(UiButton *btn) 
 {
     _targetValueField = btn;
 }
 
-void UiKeypad::addOkCallback(Callback cb)
+void UiKeypadBase::addOkCallback(Callback cb)
 {
     _okCallback = cb;
 }
-// --- UiKeypad ---
\ No newline at end of file
+// --- UiKeypad ---
@@ -1,7 +1,10 @@
 #include <Arduino.h>
 #include <LovyanGFX.hpp>
 #include "lgfx_ESP32_2432S028.h"
-#include <vector>
+#include "UiLayout.h"
+#include "UiValue.h"
+#include "UiScale.h"
+#include "UiMinMax.h"
 
 #pragma once
 
@@ -9,8 +12,9 @@
 
 
 //Forward declaration
-class UiKeypad;
+class UiKeypadBase;
 class UiButton;
+class UiSlider;
 
 using Callback = void(*)(UiButton *);
 
@@ -41,14 +45,15 @@ extern UiTheme blueTheme;
 // The user has to derive his custom panels from this class. For each
 // custom panel he must implement a keyhandler function, that processes 
 // the inputs on the touch screen. 
+// A custom panel places its components in layout() from the cells of
+// its UiLayout. layout() is called again whenever the bounds of the
+// panel change, e.g. after a rotation of the screen.
 class UiPanel
 {   
     public:
-        static std::vector<UiPanel *> panels; // Holds all panels defined in main
-        static void redrawPanels() // Redraw all panels. Called when Keypad is closed
-        { 
-            for (int i = 0; i < panels.size(); i++) panels.at(i)->show(); 
-        }
+        // Registers the static array of all panels defined in main
+        template <size_t N> static void setPanels(UiPanel *const (&list)[N]) { _panels = list; _panelCount = N; }
+        static void redrawPanels(); // Redraw all panels. Called when Keypad is closed
 
         UiPanel(LGFX &lcd, bool hidden) : 
             _lcd(lcd), _hidden(hidden)
@@ -66,10 +71,17 @@ class UiPanel
             _lcd(lcd), _x(x), _y(y),  _w(w), _h(h), _hidden(hidden)
         {}
 
+        UiPanel(LGFX &lcd, const UiRect &r, int bgColor, bool hidden) : 
+            _lcd(lcd), _x(r.x), _y(r.y), _w(r.w), _h(r.h), _bgColor(bgColor), _hidden(hidden)
+        {}
+
         virtual void show(); 
+        virtual void layout() {} // place the components, called when the bounds change
+        void setBounds(const UiRect &r);
+        UiRect getBounds();
         void hide(UiPanel *pCaller=nullptr);
         bool isHidden();
-        void addKeypad(UiKeypad *pKeypad);
+        void addKeypad(UiKeypadBase *pKeypad);
         int getPanelColor();
         void panelText(int x, int y, String text, int textColor=TFT_BLACK,  GFXfont=fonts::DejaVu18);
         LGFX &getScreen();
@@ -82,12 +94,29 @@ class UiPanel
         int _h = _lcd.height();
         int _bgColor = TFT_BLACK;    
         bool _hidden = true;
-        UiKeypad *_pKeypad = nullptr;
+        UiKeypadBase *_pKeypad = nullptr;
+
+    private:
+        static UiPanel *const *_panels; // Holds all panels defined in main
+        static uint8_t _panelCount;
 };
 
 
 // Button acts as pushbutton or input/output value field.
-// The components UiLed and UiSlider are derived classes from UiButton
+// The components UiLed, UiSlider, UiBar and UiArcMeter are derived classes 
+// from UiButton
+// A numeric value is held as typed UiValue (integer, fixed-point or 
+// float) and only formatted when the button is drawn. A text value
+// is held as String.
+// Components are usually members of their panel. As long as the panel
+// is hidden they only update their state and do not draw, so they can
+// be constructed statically before the display is initialized.
+// Between beginFrame() and endFrame() value changes only mark the 
+// component dirty. endFrame() draws every dirty component once, so
+// e.g. a slider and its value field updated several times in one pass
+// of the loop are drawn once with their last value. flush() draws
+// a pending change of one component at once, discardFrame() drops
+// all pending changes when the panels are redrawn anyway.
 class UiButton
 {
     public:
@@ -105,44 +134,59 @@ class UiButton
 
         virtual void draw();
         virtual bool touched(int x, int y);
+        virtual void place(const UiRect &r);
+        UiRect getBounds();
+        bool isVisible();
         void clearValue();
         String getValue();
         void getValue(String &value);
         void getValue(int &value);
         void getValue(double &value);
+        const UiValue &getNumber();
         void updateValue(String value);
+        void updateValue(const char *value);
         void updateValue(int value);
         void updateValue(double value);
+        void updateValue(const UiValue &value);
         void clearLabel();
         void setLabel(String label);
         String getLabel();
         void setRange(int min, int max);
         void setRange(double min, double max);
+        void setRange(double min, double max, uint8_t decimals);
         bool rangeIsInteger();
-        void addSlider(UiButton* pSlider);
+        void addSlider(UiSlider* pSlider);
         bool hasSlider();
-        UiButton *getSlider();
+        UiSlider *getSlider();
+        static void beginFrame();
+        static void endFrame();
+        static void discardFrame();
+        void flush();
 
     protected:  
+        virtual void drawValue(); // redraws after a value change, by default the whole button
+        void invalidate(bool isFull=false); // drawValue() or draw() now or at the end of the frame
+
         int _x = 0;
         int _y = 0;
         int _w; 
         int _h;
         int _d = 8;
         int _r = 4;
-        int    _minInt = 0;
-        int    _maxInt = 0;
-        int    _valInt = 0;
-        double _minDouble = 0.0;
-        double _maxDouble = 0.0;
-        double _valDouble = 0.0;
-        bool _rangeIsInteger = true; 
         UiPanel *_parent;
-        UiButton *_pSlider = nullptr;
+        UiSlider *_pSlider = nullptr;
         LGFX &_lcd = _parent->getScreen();
         UiTheme &_theme=defaultTheme;
-        String _value="";
+        String _value="";   // text value
+        UiValue _number;     // numeric value
         String _label="";
+
+    private:
+        static const uint8_t MAX_DIRTY = 32;
+        static UiButton *_dirty[MAX_DIRTY]; // components to draw at the end of the frame
+        static uint8_t _dirtyCount;
+        static bool _inFrame;
+        uint8_t _dirtyFlags = 0;            // DIRTY_VALUE, DIRTY_FULL
 };  //--- UiButton ---
 
 
@@ -160,11 +204,13 @@ class UiLed : public UiButton
 
         void draw();
         bool touched(int x, int y);
+        void place(const UiRect &r);
         void setLabel(String txt);
         bool isOn();
         void on();
         void off();
         void toggle();
+        void setColor(int color);
 
         private:
         int  _radius; // radius of slider button
@@ -173,91 +219,388 @@ class UiLed : public UiButton
 };
 
 
-// A horizontal slider with optional linked value field
-class UiHslider : public UiButton
+// Base of the sliders with optional linked value field. The knob
+// position 0..span along the track is mapped to the value by a UiScale.
+// The derived sliders convert between the knob position and pixels 
+// and draw the track and the knob.
+class UiSlider : public UiButton
 {
     public:
-        UiHslider(UiPanel *parent, int x, int y, int w, int h, int color, UiTheme &theme, String label="") : 
+        UiSlider(UiPanel *parent, int x, int y, int w, int h, int color, UiTheme &theme, String label="") : 
             UiButton(parent, x, y, w, h, theme, "", label), _color(color)
-            {_value = (_position-_x) * 100 / _w; }
+            {}
 
-        UiHslider(UiPanel *parent, int x, int y, int w, int h, int color, String label="") : 
+        UiSlider(UiPanel *parent, int x, int y, int w, int h, int color, String label="") : 
             UiButton(parent, x, y, w, h, "", label), _color(color)
-            {_value = (_position-_x) * 100 / _w; }
+            {}
 
-        UiHslider(UiPanel *parent, int x, int y, int w, int h, String label="") : 
+        UiSlider(UiPanel *parent, int x, int y, int w, int h, String label="") : 
             UiButton(parent, x, y, w, h, "", label)
-            {_value = (_position-_x) * 100 / _w; }
+            {}
 
-        void draw();
-        void slideToPosition(int x);
+        void slideToPosition(int c);
         void slideToValue(int v);
         void slideToValue(double v);
+        void slideToValue(const UiValue &v);
         void addValueField(UiButton *btn);
         bool hasValueField();
         UiButton *getValueField();
         void setRange(int min, int max);
         void setRange(double min, double max);
+        void setRange(double min, double max, uint8_t decimals);
+        void setScale(UiScaleType type, uint16_t steps=0);
         
-    private:
+    protected:
+        virtual int  trackLength() = 0;       // number of knob positions - 1
+        virtual int  toKnob(int c) = 0;       // pixel coordinate along the track to knob position
+        virtual void eraseKnob() = 0;
+        void slideToNumber();
+        void updateScale();
+        void updateValueField();
+
         int _color=TFT_LIGHTGREY;
         int _d = 10; // distance to label
         int _r = 4;  // radius of rounded rectangle
-        int _rb= 3*_h/4;  // radius of slider knob
-        int _position = _x+_w/2;
+        int _knob = 0;  // knob position 0..span
+        UiScale _scale;
         UiButton *_pValueField = nullptr; // ponter to linked value field
 };
 
-// Numeric keypad for entering numbers
-class UiKeypad : public UiPanel
+
+// A horizontal slider, the minimum is at the left
+class UiHslider : public UiSlider
 {
     public:
-        UiKeypad(LGFX &lcd, int x, int y, int bgColor, bool hidden) : 
-            UiPanel(lcd, x, y, _wp, _hp, bgColor, hidden)
-        {}
+        using UiSlider::UiSlider;
 
-        void show();
-        void handleKeys(int x, int y);
-        void addValueField(UiButton *btn);
-        void addOkCallback(Callback cb);
+        void draw();
+        void place(const UiRect &r);
+
+    protected:
+        int  trackLength();
+        int  toKnob(int c);
+        void eraseKnob();
+
+    private:
+        int _rb= 3*_h/4;  // radius of slider knob
+};
+
+
+// A vertical slider, the minimum is at the bottom. 
+// The label is shown centered below the track.
+class UiVslider : public UiSlider
+{
+    public:
+        using UiSlider::UiSlider;
+
+        void draw();
+        void place(const UiRect &r);
+
+    protected:
+        int  trackLength();
+        int  toKnob(int c);
+        void eraseKnob();
+
+    private:
+        int _rb= 3*_w/4;  // radius of slider knob
+};
+
+
+enum class UiOrientation : uint8_t { HORIZONTAL, VERTICAL };
+
+// A bar graph showing a level, e.g. of a sensor. The value is set with 
+// updateValue() and limited to the range. A value change only redraws 
+// the band between the old and the new fill level, so the bar can be
+// updated several times per second without redrawing the whole bar.
+class UiBar : public UiButton
+{
+    public:
+        UiBar(UiPanel *parent, int x, int y, int w, int h, int color, UiTheme &theme, 
+              UiOrientation orientation=UiOrientation::HORIZONTAL, String label="") : 
+            UiButton(parent, x, y, w, h, theme, "", label), _color(color), _orientation(orientation)
+            {}
+
+        UiBar(UiPanel *parent, int x, int y, int w, int h, int color, 
+              UiOrientation orientation=UiOrientation::HORIZONTAL, String label="") : 
+            UiButton(parent, x, y, w, h, "", label), _color(color), _orientation(orientation)
+            {}
+
+        void draw();
+        void place(const UiRect &r);
+        bool touched(int x, int y);
+        void setRange(int min, int max);
+        void setRange(double min, double max);
+        void setScale(UiScaleType type, uint16_t steps=0);
+
+    protected:
+        void drawValue();
+
+    private:
+        void updateScale();
+        void fillBand(int from, int to, int color);
+
+        int _color;
+        UiOrientation _orientation;
+        int _level = 0;   // fill level in pixels as last drawn
+        UiScale _scale;
+};
+
+
+// An arc meter with a sweep of 270 degrees and the value in its center.
+// Like the bar, a value change only redraws the arc segment between the
+// old and the new angle, and the value text only if it has changed.
+class UiArcMeter : public UiButton
+{
+    public:
+        static const int SWEEP = 270;   // degrees, the arc starts at the lower left
+
+        UiArcMeter(UiPanel *parent, int x, int y, int size, int color, UiTheme &theme, String label="") : 
+            UiButton(parent, x, y, size, size, theme, "", label), _color(color)
+            {}
+
+        UiArcMeter(UiPanel *parent, int x, int y, int size, int color, String label="") : 
+            UiButton(parent, x, y, size, size, "", label), _color(color)
+            {}
+
+        void draw();
+        void place(const UiRect &r);
+        bool touched(int x, int y);
+        void setRange(int min, int max);
+        void setRange(double min, double max);
+        void setRange(double min, double max, uint8_t decimals);
+
+    protected:
+        void drawValue();
 
     private:
-        int __x = _x + _gap; // origin x of the top left button (screen coords)
-        int __y = _y + _gap; // origin y of the top left button (screen coords)
+        void updateScale();
+        void fillSegment(int from, int to, int color);
+        void drawText();
+
+        int _color;
+        int _angle = 0;   // degrees of the filled arc as last drawn
+        char _text[16] = "";  // value text as last drawn
+        UiScale _scale;
+};
+
+// A streaming time-series chart, e.g. of a sensor reading. The samples
+// are appended in O(1) to a ring buffer of fixed size. The plot area is
+// rendered into a sprite: a new sample scrolls the sprite by one pixel 
+// and draws only the newest column, then the sprite is pushed to the
+// display as one block. The whole polyline is only drawn by draw(),
+// e.g. when the panel is shown. The sprite is created on the first 
+// draw, so the chart can be constructed statically.
+// With a history attached, the samples are also fed into its min/max 
+// pyramid. A window of more samples than pixel columns is then drawn
+// as min/max envelope per column, at a cost independent of its length.
+class UiChart : public UiButton
+{
+    public:
+        static const int MAX_SAMPLES = 320;   // one sample per pixel column
+
+        UiChart(UiPanel *parent, int x, int y, int w, int h, int color, UiTheme &theme) : 
+            UiButton(parent, x, y, w, h, theme, "", ""), _color(color)
+            {}
+
+        UiChart(UiPanel *parent, int x, int y, int w, int h, int color) : 
+            UiButton(parent, x, y, w, h, "", ""), _color(color)
+            {}
+
+        void draw();
+        void place(const UiRect &r);
+        bool touched(int x, int y);
+        void setRange(int min, int max);
+        void setRange(double min, double max);
+        void addSample(float v);
+        void clear();
+        int  sampleCount();
+        void setHistory(UiMinMaxPyramid *history);
+        void setWindow(uint32_t samples);
+        uint32_t getWindow();
+
+    private:
+        bool createPlot();
+        void drawColumn(int x, float v0, float v1);
+        void drawEnvelope();
+        int  toY(float v);
+
+        int   _color;
+        float _samples[MAX_SAMPLES];  // ring buffer
+        int   _head = 0;              // index of the next sample
+        int   _count = 0;             // number of samples in the buffer
+        UiScale _scale;               // maps the samples to rows of the plot
+        UiMinMaxPyramid *_history = nullptr;
+        uint32_t _window = 0;         // samples shown from the history, 0 shows the ring buffer
+        LGFX_Sprite _plot = LGFX_Sprite(&_lcd);
+};
+
+// Role of a key. The keypad dispatches on the role of the
+// tapped key, the caption is only used to draw the key.
+enum class UiKeyRole : uint8_t { NONE, DIGIT, DOT, SIGN, EXP, BACK, CLEAR, CANCEL, OK };
+
+// How the text of the entry field is passed to the target value field
+enum class UiEntry : uint8_t { DECIMAL, HEX, TEXT };
 
-        static const int _rows = 5;  // number of key rows
-        static const int _cols = 4;  // number of key columns
-        static const int _wb   = 40; // width of the keys
-        static const int _hb   = 25; // height of the keys
-        static const int _gap  = 4;  // gap between keys 
-        static const int _wp   = _cols*(_wb+_gap) + _gap; // width of the underlying panel
-        static const int _hp   = _rows*(_hb+_gap) + _gap; // height of the underlying panel
+struct UiKeyDef
+{
+    const char *caption;
+    UiKeyRole   role;
+};
+
+// Key layouts for UiKeypadT. A layout defines the number of key rows
+// and columns, the size of the keys, the kind of entry and a table with
+// one key definition per cell, row by row. The top row of the keypad
+// is occupied by the entry field and is not part of the table.
+namespace UiKeys
+{
+    constexpr UiKeyDef ___  = {"",    UiKeyRole::NONE};
+    constexpr UiKeyDef DOT  = {".",   UiKeyRole::DOT};
+    constexpr UiKeyDef SIGN = {"+/-", UiKeyRole::SIGN};
+    constexpr UiKeyDef EXP  = {"E",   UiKeyRole::EXP};
+    constexpr UiKeyDef BACK = {"C",   UiKeyRole::BACK};
+    constexpr UiKeyDef CLR  = {"Clr", UiKeyRole::CLEAR};
+    constexpr UiKeyDef X    = {"X",   UiKeyRole::CANCEL};
+    constexpr UiKeyDef OK   = {"OK",  UiKeyRole::OK};
+    constexpr UiKeyDef digit(const char *c) { return {c, UiKeyRole::DIGIT}; }
+
+    // Integer or decimal numbers with sign
+    struct Decimal
+    {
+        static constexpr int rows = 4, cols = 4, wb = 40, hb = 25, gap = 4;
+        static constexpr UiEntry entry = UiEntry::DECIMAL;
+        static constexpr bool masked = false;
+        static constexpr UiKeyDef keys[rows*cols] = {
+            digit("1"), digit("2"), digit("3"), BACK,
+            digit("4"), digit("5"), digit("6"), CLR,
+            digit("7"), digit("8"), digit("9"), X,
+            SIGN,       digit("0"), DOT,        OK };
+    };
+
+    // Floating point numbers with sign and exponent, e.g. -1.5E-3
+    struct Float
+    {
+        static constexpr int rows = 4, cols = 5, wb = 40, hb = 25, gap = 4;
+        static constexpr UiEntry entry = UiEntry::DECIMAL;
+        static constexpr bool masked = false;
+        static constexpr UiKeyDef keys[rows*cols] = {
+            digit("7"), digit("8"), digit("9"), BACK, CLR,
+            digit("4"), digit("5"), digit("6"), EXP,  X,
+            digit("1"), digit("2"), digit("3"), SIGN, ___,
+            digit("0"), DOT,        ___,        ___,  OK };
+    };
+
+    // Hexadecimal integers
+    struct Hex
+    {
+        static constexpr int rows = 4, cols = 5, wb = 40, hb = 25, gap = 4;
+        static constexpr UiEntry entry = UiEntry::HEX;
+        static constexpr bool masked = false;
+        static constexpr UiKeyDef keys[rows*cols] = {
+            digit("C"), digit("D"), digit("E"), digit("F"), BACK,
+            digit("8"), digit("9"), digit("A"), digit("B"), CLR,
+            digit("4"), digit("5"), digit("6"), digit("7"), X,
+            digit("0"), digit("1"), digit("2"), digit("3"), OK };
+    };
+
+    // PIN pad, the entered digits are shown as asterisks
+    struct Pin
+    {
+        static constexpr int rows = 4, cols = 3, wb = 50, hb = 30, gap = 4;
+        static constexpr UiEntry entry = UiEntry::TEXT;
+        static constexpr bool masked = true;
+        static constexpr UiKeyDef keys[rows*cols] = {
+            digit("1"), digit("2"), digit("3"),
+            digit("4"), digit("5"), digit("6"),
+            digit("7"), digit("8"), digit("9"),
+            X,          digit("0"), OK };
+    };
+}
+
+
+// Common part of all keypads. Edits the text of the entry field
+// according to the role of the tapped key and passes the entered
+// value to the target value field when OK is tapped.
+class UiKeypadBase : public UiPanel
+{
+    public:
+        UiKeypadBase(LGFX &lcd, int x, int y, int w, int h, int bgColor, bool hidden, UiEntry entry, bool masked) : 
+            UiPanel(lcd, x, y, w, h, bgColor, hidden), _entry(entry), _masked(masked)
+        {}
 
+        virtual void handleKeys(int x, int y) = 0;
+        void addValueField(UiButton *btn);
+        void addOkCallback(Callback cb);
+
+    protected:
+        void handleKey(const UiKeyDef &key);
+        void drawKey(const UiRect &r, const UiKeyDef &key);
+        void clearEntry();
+        void showEntry();
+        void acceptEntry();
+
+        static const int _maxLen = 16; // max number of characters in the entry field
+
+        UiEntry _entry;
+        bool    _masked;
+        char    _text[_maxLen + 1] = "";
+        uint8_t _len = 0;
         UiButton *_targetValueField = nullptr;
         Callback _okCallback = nullptr;
+        UiButton _entryField = UiButton(this, 0, 0, 0, 0, "");
+        UiButton _key        = UiButton(this, 0, 0, 0, 0, ""); // draws one key after the other
+};
+
 
-        UiButton *_btnEntry = new UiButton(this, __x, __y, (_wb + _gap)*_cols - _gap, _hb, "");
-        UiButton *_btn1     = new UiButton(this, __x,               __y+(_hb+_gap), _wb, _hb, "1");
-        UiButton *_btn2     = new UiButton(this, __x+1*(_wb + _gap), __y+(_hb+_gap), _wb, _hb, "2");
-        UiButton *_btn3     = new UiButton(this, __x+2*(_wb + _gap), __y+(_hb+_gap), _wb, _hb, "3");
-        UiButton *_btnC     = new UiButton(this, __x+3*(_wb + _gap), __y+(_hb+_gap), _wb, _hb, "C");
-
-        UiButton *_btn4   = new UiButton(this, __x,               __y+2*(_hb+_gap), _wb, _hb, "4");
-        UiButton *_btn5   = new UiButton(this, __x+1*(_wb + _gap), __y+2*(_hb+_gap), _wb, _hb, "5");
-        UiButton *_btn6   = new UiButton(this, __x+2*(_wb + _gap), __y+2*(_hb+_gap), _wb, _hb, "6"); 
-        UiButton *_btnClr = new UiButton(this, __x+3*(_wb + _gap), __y+2*(_hb+_gap), _wb, _hb, "Clr");
-
-        UiButton *_btn7      = new UiButton(this, __x,               __y+3*(_hb+_gap), _wb, _hb, "7");
-        UiButton *_btn8      = new UiButton(this, __x+1*(_wb + _gap), __y+3*(_hb+_gap), _wb, _hb, "8");
-        UiButton *_btn9      = new UiButton(this, __x+2*(_wb + _gap), __y+3*(_hb+_gap), _wb, _hb, "9");
-        UiButton *_btnCancel = new UiButton(this, __x+3*(_wb + _gap), __y+3*(_hb+_gap), _wb, _hb, "X");
-
-        UiButton *_btnSign = new UiButton(this, __x,               __y+4*(_hb+_gap), _wb, _hb, "+/-");
-        UiButton *_btn0    = new UiButton(this, __x+1*(_wb + _gap), __y+4*(_hb+_gap), _wb, _hb, "0");
-        UiButton *_btnDot  = new UiButton(this, __x+2*(_wb + _gap), __y+4*(_hb+_gap), _wb, _hb, ".");
-        UiButton *_btnOk   = new UiButton(this, __x+3*(_wb + _gap), __y+4*(_hb+_gap), _wb, _hb, "OK");
-
-        std::vector<UiButton *> _btns = {_btnEntry, _btn1, _btn2, _btn3, _btn4, _btn5, _btn6, 
-                                         _btn7, _btn8, _btn9, _btn0, _btnDot, _btnC, _btnClr, 
-                                         _btnCancel, _btnSign, _btnOk};
+// Keypad with a compile time layout L from namespace UiKeys.
+// The geometry is constexpr, so the key hit by a touch is found by a
+// division per axis and a lookup in the key table of the layout.
+template <typename L>
+class UiKeypadT : public UiKeypadBase
+{
+    public:
+        static constexpr int width  = L::cols*(L::wb + L::gap) + L::gap;      // width of the underlying panel
+        static constexpr int height = (L::rows+1)*(L::hb + L::gap) + L::gap;  // height including the entry row
+
+        UiKeypadT(LGFX &lcd, int x, int y, int bgColor, bool hidden) : 
+            UiKeypadBase(lcd, x, y, width, height, bgColor, hidden, L::entry, L::masked)
+        {
+            layout();
+        }
+
+        void layout()
+        {
+            _entryField.place({_x + L::gap, _y + L::gap, width - 2*L::gap, L::hb});
+        }
+
+        void show()
+        {
+            UiPanel::show();
+            for (int i = 0; i < L::rows*L::cols; i++)
+            {
+                drawKey(keyRect(i), L::keys[i]);
+            }
+            clearEntry();
+        }
+
+        void handleKeys(int x, int y)
+        {
+            int dx = x - _x - L::gap;
+            int dy = y - _y - L::gap;
+            if (dx < 0 || dy < 0) return;
+            int col = dx / (L::wb + L::gap);
+            int row = dy / (L::hb + L::gap) - 1; // top row is the entry field
+            if (row < 0 || row >= L::rows || col >= L::cols) return;
+            if (dx % (L::wb + L::gap) >= L::wb || dy % (L::hb + L::gap) >= L::hb) return; // gap between keys
+            handleKey(L::keys[row*L::cols + col]);
+        }
+
+    private:
+        UiRect keyRect(int i)
+        {
+            return {_x + L::gap + (i % L::cols)*(L::wb + L::gap), 
+                    _y + L::gap + (i / L::cols + 1)*(L::hb + L::gap), L::wb, L::hb};
+        }
 };
+
+// The numeric keypad used so far
+using UiKeypad = UiKeypadT<UiKeys::Decimal>;
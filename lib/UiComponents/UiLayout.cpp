@@ -0,0 +1,105 @@
+#include "UiLayout.h"
+
+
+/**
+ * Sets the area to be divided into cells. The cells are
+ * only recomputed if the area has changed since the last call.
+ * Returns true if the cells were recomputed.
+ */
+bool UiLayout::update(const UiRect &area)
+{
+    if (_valid && area == _area) return false;
+    _area = area;
+    compute();
+    _valid = true;
+    return true;
+}
+
+const UiRect &UiLayout::area() const
+{
+    return _area;
+}
+
+const UiRect &UiLayout::cell(uint8_t i) const
+{
+    return _cells[i < _count ? i : _count-1];
+}
+
+uint8_t UiLayout::count() const
+{
+    return _count;
+}
+
+/**
+ * Returns the bounding rectangle of the cells first..last,
+ * e.g. to place a component spanning a whole grid row.
+ */
+UiRect UiLayout::span(uint8_t first, uint8_t last) const
+{
+    const UiRect &a = cell(first);
+    const UiRect &b = cell(last);
+    int x0 = min(a.x, b.x);
+    int y0 = min(a.y, b.y);
+    int x1 = max(a.x + a.w, b.x + b.w);
+    int y1 = max(a.y + a.h, b.y + b.h);
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+/**
+ * Returns the index of the cell containing the point x,y
+ * or -1 if the point lies on the padding or in a gap.
+ * Grid cells are found arithmetically, rows and columns
+ * by scanning the few cached cell rectangles.
+ */
+int UiLayout::hitTest(int x, int y) const
+{
+    if (!_valid) return -1;
+    if (_flow == UiFlow::GRID)
+    {
+        int dx = x - _area.x - _padding;
+        int dy = y - _area.y - _padding;
+        if (dx < 0 || dy < 0) return -1;
+        int col = dx / (_cw + _gap);
+        int row = dy / (_ch + _gap);
+        if (col >= _cols || dx - col*(_cw + _gap) >= _cw || dy - row*(_ch + _gap) >= _ch) return -1;
+        int i = row*_cols + col;
+        return i < _count ? i : -1;
+    }
+    for (int i = 0; i < _count; i++)
+    {
+        if (_cells[i].contains(x, y)) return i;
+    }
+    return -1;
+}
+
+void UiLayout::compute()
+{
+    UiRect inner = _area.inset(_padding, _padding);
+    if (_flow == UiFlow::GRID)
+    {
+        int rows = (_count + _cols - 1) / _cols;
+        _cw = (inner.w - (_cols-1)*_gap) / _cols;
+        _ch = (inner.h - (rows-1)*_gap) / rows;
+        for (int i = 0; i < _count; i++)
+        {
+            _cells[i] = {inner.x + (i % _cols)*(_cw + _gap), inner.y + (i / _cols)*(_ch + _gap), _cw, _ch};
+        }
+        return;
+    }
+
+    // Rows and columns are distributed according to their weights.
+    // The last cell takes the pixels lost by integer division.
+    bool isRow = (_flow == UiFlow::ROW);
+    int total = 0;
+    for (int i = 0; i < _count; i++) total += _weights ? _weights[i] : 1;
+    int avail = (isRow ? inner.w : inner.h) - (_count-1)*_gap;
+    int pos = isRow ? inner.x : inner.y;
+    int end = pos + avail + (_count-1)*_gap;
+    for (int i = 0; i < _count; i++)
+    {
+        int size = (i == _count-1) ? end - pos : avail * (_weights ? _weights[i] : 1) / total;
+        _cells[i] = isRow ? UiRect{pos, inner.y, size, inner.h} : UiRect{inner.x, pos, inner.w, size};
+        pos += size + _gap;
+    }
+}
+// --- UiLayout ---
@@ -0,0 +1,70 @@
+#include <Arduino.h>
+
+#pragma once
+
+// A rectangle in screen coordinates. It is the unit of geometry
+// exchanged between the layouts, the panels and the components.
+struct UiRect
+{
+    int x = 0;
+    int y = 0;
+    int w = 0;
+    int h = 0;
+
+    bool contains(int px, int py) const { return (px >= x && px < x+w && py >= y && py < y+h); }
+    bool operator==(const UiRect &r) const { return (x == r.x && y == r.y && w == r.w && h == r.h); }
+    bool operator!=(const UiRect &r) const { return !(*this == r); }
+
+    UiRect inset(int dx, int dy) const { return {x+dx, y+dy, w-2*dx, h-2*dy}; }
+    UiRect left(int width) const { return {x, y, width, h}; }                // left part with the given width
+    UiRect centered(int width, int height) const                              // centered sub rectangle
+        { return {x + (w-width)/2, y + (h-height)/2, width, height}; }
+    UiRect leftCentered(int width, int height) const                          // left aligned, vertically centered
+        { return {x, y + (h-height)/2, width, height}; }
+};
+
+
+enum class UiFlow : uint8_t { ROW, COLUMN, GRID };
+
+// A layout divides a rectangular area into cells. The cells are arranged
+// in a row (left to right), a column (top to bottom) or a grid with a
+// given number of columns (row by row). Rows and columns can be weighted,
+// grid cells are of equal size. The area is surrounded by a padding and
+// the cells are separated by a gap.
+// The cell rectangles are computed once and cached. They are only
+// recomputed when update() is called with a different area, which
+// happens when the screen is rotated or a panel is resized.
+// The cached rectangles are the geometry table used to place the
+// components and to find the component hit by a touch.
+class UiLayout
+{
+    public:
+        static const uint8_t MAX_CELLS = 24;
+
+        UiLayout(UiFlow flow, uint8_t count, uint8_t cols=1, int padding=0, int gap=0, const uint8_t *weights=nullptr) :
+            _flow(flow), _count(count > MAX_CELLS ? MAX_CELLS : count), _cols(cols < 1 ? 1 : cols),
+            _padding(padding), _gap(gap), _weights(weights)
+        {}
+
+        bool update(const UiRect &area);
+        const UiRect &area() const;
+        const UiRect &cell(uint8_t i) const;
+        UiRect span(uint8_t first, uint8_t last) const;
+        int hitTest(int x, int y) const;
+        uint8_t count() const;
+
+    private:
+        void compute();
+
+        UiFlow  _flow;
+        uint8_t _count;
+        uint8_t _cols;    // number of columns of a grid
+        int     _padding; // space around the cells
+        int     _gap;     // space between the cells
+        const uint8_t *_weights = nullptr; // relative sizes of rows or columns, equal if nullptr
+        int     _cw = 0;  // cell width of a grid
+        int     _ch = 0;  // cell height of a grid
+        bool    _valid = false;
+        UiRect  _area;
+        UiRect  _cells[MAX_CELLS];
+};
@@ -0,0 +1,83 @@
+#include "UiMinMax.h"
+
+
+/**
+ * Adds a sample. Completing an odd entry of a level
+ * combines it with its even neighbour into the next level.
+ */
+void UiMinMaxPyramid::add(float v)
+{
+    UiMinMax e = {v, v};
+    for (uint8_t k = 0; k < LEVELS; k++)
+    {
+        uint32_t j = _n[k]++;
+        _rings[k][j % SIZE] = e;
+        if ((j & 1) == 0) break;   // the pair of this level is not yet complete
+        const UiMinMax &p = _rings[k][(j - 1) % SIZE];
+        e = {min(p.min, e.min), max(p.max, e.max)};
+    }
+}
+
+void UiMinMaxPyramid::clear()
+{
+    for (uint8_t k = 0; k < LEVELS; k++) _n[k] = 0;
+}
+
+// Number of samples added
+uint32_t UiMinMaxPyramid::count() const
+{
+    return _n[0];
+}
+
+// Number of samples covered by the coarsest level
+uint32_t UiMinMaxPyramid::capacity() const
+{
+    return static_cast<uint32_t>(SIZE) << (LEVELS - 1);
+}
+
+/**
+ * Returns in env the envelope of column c, when the latest span samples
+ * are divided into the given number of columns. Returns false if the 
+ * column holds no samples, i.e. lies before the first sample or in the
+ * most recent entry of the chosen level that is not yet complete.
+ */
+bool UiMinMaxPyramid::column(uint32_t span, int columns, int c, UiMinMax &env) const
+{
+    if (columns <= 0 || span == 0) return false;
+    uint8_t k = levelFor(span, columns);
+    // Samples a..b-1 of the column, the window ends with the latest sample.
+    // With fewer samples than the window the first columns are empty.
+    int64_t start = static_cast<int64_t>(_n[0]) - span;
+    int64_t a = start + static_cast<int64_t>(c) * span / columns;
+    int64_t b = start + static_cast<int64_t>(c + 1) * span / columns;
+    if (b <= 0) return false;
+    if (a < 0) a = 0;
+    if (b <= a) b = a + 1;
+
+    uint32_t first = _n[k] > SIZE ? _n[k] - SIZE : 0;  // oldest entry still in the ring
+    uint32_t ja = max(static_cast<uint32_t>(a >> k), first);
+    uint32_t jb = static_cast<uint32_t>((b - 1) >> k);
+    if (jb >= _n[k]) jb = _n[k] - 1;
+    if (_n[k] == 0 || ja > jb) return false;
+
+    env = _rings[k][ja % SIZE];
+    for (uint32_t j = ja + 1; j <= jb; j++)
+    {
+        const UiMinMax &e = _rings[k][j % SIZE];
+        if (e.min < env.min) env.min = e.min;
+        if (e.max > env.max) env.max = e.max;
+    }
+    return true;
+}
+
+// The coarsest level whose entries cover at most the samples of one
+// column, or a coarser one if its ring does not hold the whole window
+uint8_t UiMinMaxPyramid::levelFor(uint32_t span, int columns) const
+{
+    uint32_t perColumn = span / columns;
+    uint8_t k = 0;
+    while (k < LEVELS-1 && (2u << k) <= perColumn) k++;
+    while (k < LEVELS-1 && (static_cast<uint32_t>(SIZE) << k) < span) k++;
+    return k;
+}
+// --- UiMinMaxPyramid ---
@@ -0,0 +1,38 @@
+#include <Arduino.h>
+
+#pragma once
+
+// Minimum and maximum of a range of samples
+struct UiMinMax
+{
+    float min;
+    float max;
+};
+
+// A multi-resolution min/max pyramid of a time series. Level 0 holds
+// the latest samples, each entry of level k the envelope of 2^k samples.
+// Every level is a ring of SIZE entries, so RAM is bounded while level 
+// LEVELS-1 still covers SIZE * 2^(LEVELS-1) samples, e.g. 22 hours of
+// samples taken every 2.5 s.
+// Samples are ingested incrementally: completing two entries of a level
+// completes one entry of the next level. A chart column covering n 
+// samples is served from the level whose entries cover about n/2 .. n
+// samples, so rendering costs O(columns) whatever the history length.
+class UiMinMaxPyramid
+{
+    public:
+        static const uint8_t  LEVELS = 8;
+        static const uint16_t SIZE = 256;
+
+        void add(float v);
+        void clear();
+        uint32_t count() const;
+        uint32_t capacity() const;
+        bool column(uint32_t span, int columns, int c, UiMinMax &env) const;
+
+    private:
+        uint8_t levelFor(uint32_t span, int columns) const;
+
+        UiMinMax _rings[LEVELS][SIZE];
+        uint32_t _n[LEVELS] = {};  // number of entries ever completed per level
+};
@@ -0,0 +1,148 @@
+#include "UiQueue.h"
+
+static const uint32_t MASK = UiQueue::SIZE - 1;
+
+
+// The sequence number of a free slot equals the position 
+// that may claim it, a filled slot holds position + 1
+UiQueue::UiQueue()
+{
+    for (uint32_t i = 0; i < SIZE; i++) _slots[i].seq.store(i, std::memory_order_relaxed);
+}
+
+/**
+ * Posts a command, may be called from any task.
+ * Returns false if the queue is full.
+ */
+bool UiQueue::post(const UiCommand &cmd)
+{
+    uint32_t pos = _head.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;)
+    {
+        slot = &_slots[pos & MASK];
+        int32_t dif = static_cast<int32_t>(slot->seq.load(std::memory_order_acquire) - pos);
+        if (dif == 0)
+        {
+            if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if (dif < 0)
+        {
+            return false;   // the consumer has not yet read this slot
+        }
+        else
+        {
+            pos = _head.load(std::memory_order_relaxed);
+        }
+    }
+    slot->cmd = cmd;
+    slot->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool UiQueue::postText(UiButton *target, const char *text, Callback done)
+{
+    UiCommand cmd = { target, UiCommandType::TEXT, done };
+    strlcpy(cmd.text, text, sizeof(cmd.text));
+    return post(cmd);
+}
+
+bool UiQueue::postInt(UiButton *target, int value, Callback done)
+{
+    UiCommand cmd = { target, UiCommandType::INT, done };
+    cmd.i = value;
+    return post(cmd);
+}
+
+bool UiQueue::postDouble(UiButton *target, double value, Callback done)
+{
+    UiCommand cmd = { target, UiCommandType::DOUBLE, done };
+    cmd.d = value;
+    return post(cmd);
+}
+
+bool UiQueue::postSlide(UiSlider *slider, double value, Callback done)
+{
+    UiCommand cmd = { slider, UiCommandType::SLIDE, done };
+    cmd.d = value;
+    return post(cmd);
+}
+
+bool UiQueue::postLed(UiLed *led, bool isOn, Callback done)
+{
+    UiCommand cmd = { led, isOn ? UiCommandType::LED_ON : UiCommandType::LED_OFF, done };
+    return post(cmd);
+}
+
+// Commands of the same kind set the same state of a widget: 
+// its value, the position of a slider or the state of a LED
+static uint8_t kind(UiCommandType type)
+{
+    switch (type)
+    {
+        case UiCommandType::SLIDE:   return 1;
+        case UiCommandType::LED_ON:
+        case UiCommandType::LED_OFF: return 2;
+        default:                     return 0;   // TEXT, INT, DOUBLE
+    }
+}
+
+/**
+ * Applies the queued commands, call it in the loop of the UI task.
+ * A command followed by a later one of the same kind for the same 
+ * widget is skipped, its done callback is called after the later 
+ * one has been applied. Returns the number of commands applied.
+ */
+int UiQueue::process()
+{
+    UiCommand batch[SIZE];
+    bool isOverwritten[SIZE];
+    int n = 0;
+    while (n < SIZE && pop(batch[n])) n++;
+
+    int applied = 0;
+    for (int i = 0; i < n; i++)
+    {
+        isOverwritten[i] = false;
+        for (int j = i + 1; j < n && ! isOverwritten[i]; j++) 
+        {
+            isOverwritten[i] = (batch[j].target == batch[i].target && kind(batch[j].type) == kind(batch[i].type));
+        }
+        if (isOverwritten[i]) continue;
+        apply(batch[i]);
+        applied++;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        if (isOverwritten[i] && batch[i].done != nullptr) batch[i].done(batch[i].target);
+    }
+    return applied;
+}
+
+bool UiQueue::pop(UiCommand &cmd)
+{
+    Slot &slot = _slots[_tail & MASK];
+    if (slot.seq.load(std::memory_order_acquire) != _tail + 1) return false;  // empty
+    cmd = slot.cmd;
+    slot.seq.store(_tail + SIZE, std::memory_order_release);  // free for the next round
+    _tail++;
+    return true;
+}
+
+void UiQueue::apply(const UiCommand &cmd)
+{
+    UiButton *target = cmd.target;
+    switch (cmd.type)
+    {
+        case UiCommandType::TEXT:   target->updateValue(cmd.text); break;
+        case UiCommandType::INT:    target->updateValue(static_cast<int>(cmd.i)); break;
+        case UiCommandType::DOUBLE: target->updateValue(cmd.d); break;
+        case UiCommandType::SLIDE:  static_cast<UiSlider*>(target)->slideToValue(cmd.d); break;
+        case UiCommandType::LED_ON:  static_cast<UiLed*>(target)->on(); break;
+        case UiCommandType::LED_OFF: static_cast<UiLed*>(target)->off(); break;
+    }
+    bool isValue = (cmd.type == UiCommandType::TEXT || cmd.type == UiCommandType::INT || cmd.type == UiCommandType::DOUBLE);
+    if (isValue && target->hasSlider()) target->getSlider()->slideToValue(target->getNumber());
+    if (cmd.done != nullptr) cmd.done(target);
+}
+// --- UiQueue ---
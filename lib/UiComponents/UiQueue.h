@@ -0,0 +1,64 @@
+#include <Arduino.h>
+#include <atomic>
+#include "UiComponents.h"
+
+#pragma once
+
+// Change of a widget requested by another task
+//   TEXT, INT, DOUBLE  updateValue(), a linked slider follows
+//   SLIDE              slideToValue() of a slider
+//   LED_ON, LED_OFF    on(), off() of a LED
+enum class UiCommandType : uint8_t { TEXT, INT, DOUBLE, SLIDE, LED_ON, LED_OFF };
+
+struct UiCommand
+{
+    static const size_t TEXT_SIZE = 24;
+
+    UiButton     *target;
+    UiCommandType type;
+    Callback      done;     // called by the UI task after the change, may be nullptr
+    int32_t       i;
+    double        d;
+    char          text[TEXT_SIZE];
+};
+
+// Commands from any task to the UI task. Widgets must only be drawn by
+// the UI task, since LovyanGFX keeps font, datum and colors as shared
+// state. Other tasks post their changes, the UI task calls process() 
+// in its loop and applies them in one pass.
+// The queue is a bounded lock-free ring for many producers and one 
+// consumer: a producer claims a slot by compare-and-swap on the head,
+// fills it and publishes it with the sequence number of the slot. 
+// A full queue rejects the command instead of blocking the producer.
+// Several commands of the same kind (value, slide, LED) for the same 
+// widget in one pass are coalesced, only the last one is applied.
+// The done callback of every command is called, that of a skipped
+// command once the command which replaced it has been applied.
+class UiQueue
+{
+    public:
+        static const uint8_t SIZE = 32;   // power of 2
+
+        UiQueue();
+        bool post(const UiCommand &cmd);
+        bool postText(UiButton *target, const char *text, Callback done=nullptr);
+        bool postInt(UiButton *target, int value, Callback done=nullptr);
+        bool postDouble(UiButton *target, double value, Callback done=nullptr);
+        bool postSlide(UiSlider *slider, double value, Callback done=nullptr);
+        bool postLed(UiLed *led, bool isOn, Callback done=nullptr);
+        int  process();
+
+    private:
+        struct Slot
+        {
+            std::atomic<uint32_t> seq;
+            UiCommand cmd;
+        };
+
+        bool pop(UiCommand &cmd);
+        void apply(const UiCommand &cmd);
+
+        Slot _slots[SIZE];
+        std::atomic<uint32_t> _head{0};  // next slot claimed by a producer
+        uint32_t _tail = 0;              // next slot read by the consumer
+};
@@ -0,0 +1,143 @@
+#include "UiScale.h"
+
+
+void UiScale::setType(UiScaleType type, uint16_t steps)
+{
+    _type = type;
+    _steps = steps;
+    update(_min, _max, _span);
+}
+
+UiScaleType UiScale::type() const
+{
+    return _type;
+}
+
+int UiScale::span() const
+{
+    return _span;
+}
+
+float UiScale::lower() const
+{
+    return _min;
+}
+
+float UiScale::upper() const
+{
+    return _max;
+}
+
+/**
+ * Precomputes the coefficients or the table for the range min..max
+ * and the knob positions 0..span. A log scale with a range that is 
+ * not positive falls back to a linear scale.
+ */
+void UiScale::update(float min, float max, int span)
+{
+    _min  = min;
+    _max  = max;
+    _span = span > 1 ? span : 1;
+    bool isLog = (_type == UiScaleType::LOG && min > 0.0f && max > 0.0f);
+
+    if (isLog)
+    {
+        // The table is computed once per change, the drag path only interpolates
+        double ratio = log(static_cast<double>(max) / min);
+        for (int i = 0; i <= LUT_SEGMENTS; i++)
+        {
+            _lut[i] = min * exp(ratio * i / LUT_SEGMENTS);
+        }
+        _lut[LUT_SEGMENTS] = max;
+        _k = static_cast<float>(LUT_SEGMENTS) / _span; // segments per pixel
+        _kinv = 1.0f / _k;
+    }
+    else if (_type == UiScaleType::STEPPED && _steps > 0)
+    {
+        _k = (max - min) / _steps;
+        _kinv = (max != min) ? _steps / (max - min) : 0.0f;
+    }
+    else
+    {
+        _k = (max - min) / _span;
+        _kinv = (max != min) ? _span / (max - min) : 0.0f;
+    }
+}
+
+/**
+ * Returns the value at the knob position 0..span
+ */
+float UiScale::toValue(int position) const
+{
+    if (position < 0) position = 0;
+    if (position > _span) position = _span;
+
+    switch (_type)
+    {
+        case UiScaleType::LOG:
+            if (_min > 0.0f && _max > 0.0f)
+            {
+                float t = position * _k;
+                int i = static_cast<int>(t);
+                if (i >= LUT_SEGMENTS) return _lut[LUT_SEGMENTS];
+                return _lut[i] + (_lut[i+1] - _lut[i]) * (t - i);
+            }
+        break;
+
+        case UiScaleType::STEPPED:
+            if (_steps > 0)
+            {
+                int step = (position * _steps + _span/2) / _span;
+                return _min + step * _k;
+            }
+        break;
+
+        default:
+        break;
+    }
+    return _min + position * _k;
+}
+
+/**
+ * Returns the knob position 0..span of the value
+ */
+int UiScale::toPosition(float value) const
+{
+    float p;
+    switch (_type)
+    {
+        case UiScaleType::LOG:
+            if (_min > 0.0f && _max > 0.0f)
+            {
+                if (value <= _lut[0]) return 0;
+                if (value >= _lut[LUT_SEGMENTS]) return _span;
+                int lo = 0, hi = LUT_SEGMENTS;  // find the segment containing the value
+                while (hi - lo > 1)
+                {
+                    int mid = (lo + hi) / 2;
+                    if (_lut[mid] <= value) lo = mid; else hi = mid;
+                }
+                float t = lo + (value - _lut[lo]) / (_lut[hi] - _lut[lo]);
+                return lroundf(t * _kinv);
+            }
+            // fall through
+        default:
+            p = (value - _min) * _kinv;
+        break;
+
+        case UiScaleType::STEPPED:
+            if (_steps > 0)
+            {
+                int step = lroundf((value - _min) * _kinv);
+                p = static_cast<float>(step) * _span / _steps;
+            }
+            else
+            {
+                p = (value - _min) * _kinv;
+            }
+        break;
+    }
+    int position = lroundf(p);
+    return position < 0 ? 0 : position > _span ? _span : position;
+}
+// --- UiScale ---
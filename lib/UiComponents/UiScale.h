@@ -0,0 +1,42 @@
+#include <Arduino.h>
+
+#pragma once
+
+// Scale of a slider
+//   LINEAR   the value is proportional to the knob position
+//   LOG      the logarithm of the value is proportional to the position, 
+//            e.g. for frequencies. Requires a positive range.
+//   STEPPED  linear with a given number of steps, the knob snaps to the steps
+enum class UiScaleType : uint8_t { LINEAR, LOG, STEPPED };
+
+// Maps knob positions 0..span (pixels) to values in min..max and back.
+// The mapping is precomputed whenever the range or the track length 
+// changes: linear and stepped scales by their coefficients, the log
+// scale by a table of values at equidistant positions which is
+// interpolated linearly. Both directions use the same coefficients or 
+// table, so a value and its position map onto each other without drift.
+// Only single precision float arithmetic is used in the mapping.
+class UiScale
+{
+    public:
+        static const int LUT_SEGMENTS = 32;
+
+        void setType(UiScaleType type, uint16_t steps=0);
+        UiScaleType type() const;
+        void update(float min, float max, int span);
+        float toValue(int position) const;
+        int toPosition(float value) const;
+        int span() const;
+        float lower() const;
+        float upper() const;
+
+    private:
+        UiScaleType _type = UiScaleType::LINEAR;
+        uint16_t _steps = 0;
+        int   _span = 0;
+        float _min = 0.0f;
+        float _max = 0.0f;
+        float _k = 0.0f;    // value per pixel, or value per step
+        float _kinv = 0.0f; // pixels per value, or steps per value
+        float _lut[LUT_SEGMENTS + 1]; // values of the log scale at equidistant positions
+};
@@ -0,0 +1,308 @@
+#include "UiValue.h"
+
+static const int32_t POW10[UiValue::MAX_DECIMALS + 1] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+static const int64_t DIGITS_MAX = 1000000000000LL;   // beyond int32 even without decimals
+
+// Clamps a raw value to the range of int32
+static int32_t saturate(int64_t v)
+{
+    return v < INT32_MIN ? INT32_MIN : v > INT32_MAX ? INT32_MAX : static_cast<int32_t>(v);
+}
+
+// Appends a digit, long digit strings stop growing at DIGITS_MAX
+static int64_t appendDigit(int64_t v, char digit)
+{
+    return min(v*10 + (digit - '0'), DIGITS_MAX);
+}
+
+
+/**
+ * Sets the type of the value. A value that is already
+ * set is converted to the new type.
+ */
+void UiValue::setType(UiValueType type, uint8_t decimals)
+{
+    double v = toDouble();
+    _type = type;
+    _decimals = (type == UiValueType::FIXED) ? min(decimals, MAX_DECIMALS) : 0;
+    _hasRange = false;
+    if (isNumeric()) set(v);
+}
+
+UiValueType UiValue::type() const
+{
+    return _type;
+}
+
+uint8_t UiValue::decimals() const
+{
+    return _decimals;
+}
+
+bool UiValue::isNumeric() const
+{
+    return _type != UiValueType::TEXT;
+}
+
+bool UiValue::isInteger() const
+{
+    return _type == UiValueType::INT;
+}
+
+/**
+ * Sets an integer range, the value becomes an integer
+ */
+void UiValue::setRange(int min, int max)
+{
+    if (_type != UiValueType::INT) setType(UiValueType::INT);
+    _rawMin = min;
+    _rawMax = max;
+    _hasRange = true;
+    _raw = limit(_raw);
+}
+
+/**
+ * Sets a range of real numbers. A fixed-point value keeps its
+ * number of decimals, any other value becomes a float.
+ */
+void UiValue::setRange(double min, double max)
+{
+    if (_type == UiValueType::FIXED)
+    {
+        _rawMin = toRaw(min);
+        _rawMax = toRaw(max);
+        _hasRange = true;
+        _raw = limit(_raw);
+    }
+    else
+    {
+        if (_type != UiValueType::FLOAT) setType(UiValueType::FLOAT);
+        _floatMin = min;
+        _floatMax = max;
+        _hasRange = true;
+        _float = limit(_float);
+    }
+}
+
+bool UiValue::hasRange() const
+{
+    return _hasRange;
+}
+
+void UiValue::set(int v)
+{
+    switch (_type)
+    {
+        case UiValueType::TEXT:
+            _type = UiValueType::INT;
+            // fall through
+        case UiValueType::INT:
+            _raw = limit(static_cast<int32_t>(v));
+        break;
+        case UiValueType::FIXED:
+            _raw = limit(saturate(static_cast<int64_t>(v) * POW10[_decimals]));
+        break;
+        case UiValueType::FLOAT:
+            _float = limit(static_cast<float>(v));
+        break;
+    }
+}
+
+void UiValue::set(double v)
+{
+    switch (_type)
+    {
+        case UiValueType::TEXT:
+            _type = UiValueType::FLOAT;
+            // fall through
+        case UiValueType::FLOAT:
+            _float = limit(static_cast<float>(v));
+        break;
+        case UiValueType::INT:
+        case UiValueType::FIXED:
+            _raw = limit(toRaw(v));
+        break;
+    }
+}
+
+/**
+ * Sets the raw value of an integer or fixed-point number
+ */
+void UiValue::setRaw(int32_t raw)
+{
+    if (_type == UiValueType::FLOAT) _float = limit(static_cast<float>(raw));
+    else _raw = limit(raw);
+}
+
+/**
+ * Sets the value in units, see units()
+ */
+void UiValue::setUnits(float u)
+{
+    if (_type == UiValueType::FLOAT) _float = limit(u);
+    else _raw = limit(static_cast<int32_t>(lroundf(u)));
+}
+
+/**
+ * Parses the text entered on a keypad. Fixed-point numbers
+ * without exponent are parsed digit by digit into the raw value.
+ * Returns false if the value is not numeric.
+ */
+bool UiValue::parse(const char *text)
+{
+    switch (_type)
+    {
+        case UiValueType::TEXT:
+            return false;
+
+        case UiValueType::INT:
+            set(static_cast<int>(strtol(text, nullptr, 10)));
+        break;
+
+        case UiValueType::FLOAT:
+            set(strtod(text, nullptr));
+        break;
+
+        case UiValueType::FIXED:
+        {
+            if (strpbrk(text, "Ee") != nullptr)
+            {
+                set(strtod(text, nullptr));
+                break;
+            }
+            const char *p = text;
+            bool negative = (*p == '-');
+            if (negative || *p == '+') p++;
+            int64_t raw = 0;
+            while (isdigit(*p)) raw = appendDigit(raw, *p++);
+            int d = 0;
+            if (*p == '.')
+            {
+                p++;
+                for (; d < _decimals && isdigit(*p); d++) raw = appendDigit(raw, *p++);
+                if (isdigit(*p) && *p >= '5') raw++; // round at the first dropped digit
+            }
+            for (; d < _decimals; d++) raw *= 10;
+            setRaw(saturate(negative ? -raw : raw));
+        }
+        break;
+    }
+    return true;
+}
+
+int32_t UiValue::raw() const
+{
+    return _raw;
+}
+
+int32_t UiValue::rawMin() const
+{
+    return _rawMin;
+}
+
+int32_t UiValue::rawMax() const
+{
+    return _rawMax;
+}
+
+float UiValue::floatMin() const
+{
+    return _floatMin;
+}
+
+float UiValue::floatMax() const
+{
+    return _floatMax;
+}
+
+int UiValue::toInt() const
+{
+    switch (_type)
+    {
+        case UiValueType::INT:   return _raw;
+        case UiValueType::FIXED: return (_raw + (_raw < 0 ? -1 : 1) * POW10[_decimals]/2) / POW10[_decimals];
+        case UiValueType::FLOAT: return lroundf(_float);
+        default:                 return 0;
+    }
+}
+
+double UiValue::toDouble() const
+{
+    switch (_type)
+    {
+        case UiValueType::INT:   return _raw;
+        case UiValueType::FIXED: return static_cast<double>(_raw) / POW10[_decimals];
+        case UiValueType::FLOAT: return _float;
+        default:                 return 0.0;
+    }
+}
+
+/**
+ * The value in the units in which it is held, i.e. the raw value of
+ * an integer or fixed-point number and the value of a float. Scales
+ * map positions to units and back without converting to double.
+ */
+float UiValue::units() const
+{
+    return (_type == UiValueType::FLOAT) ? _float : static_cast<float>(_raw);
+}
+
+float UiValue::unitsMin() const
+{
+    return (_type == UiValueType::FLOAT) ? _floatMin : static_cast<float>(_rawMin);
+}
+
+float UiValue::unitsMax() const
+{
+    return (_type == UiValueType::FLOAT) ? _floatMax : static_cast<float>(_rawMax);
+}
+
+/**
+ * Formats the value into buf. Integers and fixed-point numbers are
+ * formatted with integer arithmetic, floats with 4 significant digits.
+ */
+size_t UiValue::format(char *buf, size_t size) const
+{
+    switch (_type)
+    {
+        case UiValueType::INT:
+            return snprintf(buf, size, "%ld", static_cast<long>(_raw));
+
+        case UiValueType::FIXED:
+        {
+            if (_decimals == 0) return snprintf(buf, size, "%ld", static_cast<long>(_raw));
+            uint32_t a = _raw < 0 ? -static_cast<int64_t>(_raw) : _raw;
+            return snprintf(buf, size, "%s%lu.%0*lu", _raw < 0 ? "-" : "",
+                            static_cast<unsigned long>(a / POW10[_decimals]), _decimals,
+                            static_cast<unsigned long>(a % POW10[_decimals]));
+        }
+
+        case UiValueType::FLOAT:  // prevents exponential representation like -4.0957e-16
+            return snprintf(buf, size, "%.4g", fabsf(_float) < 1.0e-12f ? 0.0f : _float);
+
+        default:
+            if (size > 0) buf[0] = '\0';
+            return 0;
+    }
+}
+
+int32_t UiValue::toRaw(double v) const
+{
+    v *= POW10[_decimals];
+    if (! (v > INT32_MIN)) return INT32_MIN;     // NaN too
+    if (v > INT32_MAX) return INT32_MAX;
+    return lround(v);
+}
+
+int32_t UiValue::limit(int32_t raw) const
+{
+    if (! _hasRange) return raw;
+    return raw < _rawMin ? _rawMin : raw > _rawMax ? _rawMax : raw;
+}
+
+float UiValue::limit(float v) const
+{
+    if (! _hasRange) return v;
+    return v < _floatMin ? _floatMin : v > _floatMax ? _floatMax : v;
+}
+// --- UiValue ---
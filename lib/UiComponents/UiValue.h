@@ -0,0 +1,62 @@
+#include <Arduino.h>
+
+#pragma once
+
+// Type of the value shown by a button. TEXT is shown as is, the
+// numeric types are held natively and only formatted when drawn.
+//   INT    32 bit integer
+//   FIXED  fixed-point number, held as integer scaled by 10^decimals
+//   FLOAT  single precision float, formatted with 4 significant digits
+enum class UiValueType : uint8_t { TEXT, INT, FIXED, FLOAT };
+
+// A typed numeric value with an optional range. Integers and fixed-point
+// numbers are kept as raw int32, so setting, limiting and formatting
+// them needs neither string parsing nor floating point arithmetic.
+class UiValue
+{
+    public:
+        static constexpr uint8_t MAX_DECIMALS = 6;
+
+        void setType(UiValueType type, uint8_t decimals=0);
+        UiValueType type() const;
+        uint8_t decimals() const;
+        bool isNumeric() const;
+        bool isInteger() const;
+
+        void setRange(int min, int max);
+        void setRange(double min, double max);
+        bool hasRange() const;
+
+        void set(int v);
+        void set(double v);
+        void setRaw(int32_t raw);
+        void setUnits(float u);
+        bool parse(const char *text);
+
+        int32_t raw() const;
+        int32_t rawMin() const;
+        int32_t rawMax() const;
+        float   floatMin() const;
+        float   floatMax() const;
+        int     toInt() const;
+        double  toDouble() const;
+        float   units() const;
+        float   unitsMin() const;
+        float   unitsMax() const;
+        size_t  format(char *buf, size_t size) const;
+
+    private:
+        int32_t toRaw(double v) const;
+        int32_t limit(int32_t raw) const;
+        float   limit(float v) const;
+
+        UiValueType _type = UiValueType::TEXT;
+        uint8_t _decimals = 0;
+        bool    _hasRange = false;
+        int32_t _raw = 0;      // value of INT and FIXED
+        int32_t _rawMin = 0;
+        int32_t _rawMax = 0;
+        float   _float = 0.0f; // value of FLOAT
+        float   _floatMin = 0.0f;
+        float   _floatMax = 0.0f;
+};
@@ -3,18 +3,18 @@
 #include "ESP32AutoConnect.h"
 
 /**
- * Print nearby WiFi networks with SSID und RSSI 
+ * Print nearby WiFi networks with SSID und RSSI, the strongest first.
+ * Called when the scan cache has new results.
  */
-void printNearbyNetworks()
+void printNearbyNetworks(WiFiScanCache &scan)
 {
-  int n = WiFi.scanNetworks();
   printf(R"(
 Nearby WiFi networks:
 --------------------
 )");
-  for (int i = 0; i < n; i++)
+  for (int i = 0; i < scan.count(); i++)
   {
-    printf("%s\t%d\r\n", WiFi.SSID(i).c_str(), WiFi.RSSI(i));
+    printf("%s\t%d\r\n", scan.network(i).ssid, scan.network(i).rssi);
   }
 }
 
@@ -42,9 +42,14 @@ Connection Details:
 }
 
 
-void initESP32AutoConnect(AsyncWebServer &webServer, Preferences &prefs, const char hostname[])
+/**
+ * Starts connecting to the WLAN and returns at once. 
+ * The connection is advanced by ac.loop() in the main loop.
+ */
+void initESP32AutoConnect(ESP32AutoConnect &ac, WiFiStateCallback onStateChange)
 {
-  ESP32AutoConnect ac(webServer, prefs, hostname);
   //ac.clearCredentials();  // activate this line to remove stored credentials
+  ac.onStateChange(onStateChange);
+  ac.networks().onUpdate(printNearbyNetworks);
   ac.autoConnect();
 }
\ No newline at end of file
@@ -1,43 +1,28 @@
 #include <Arduino.h>
-#include <Preferences.h>
+#include "Settings.h"
 
-extern Preferences prefs;
-extern int currentStation;
-extern float currentVolume;
+extern Settings settings;
 
 
 /**
- * Print alarm times retrieved from preferences namespace "alarms"
- * and also piepser state, clock variant and INIT_FLAG
+ * Print the settings held in RAM, each value
+ * formatted according to its type
  */
 void printPrefs()
 {
-  prefs.begin("SETTINGS", true);
-  Serial.printf("STATION    %d\n", prefs.getInt("STATION"));
-  Serial.printf("VOLUME     %4.2f\n", prefs.getInt("VOLUME"));
-  Serial.printf("INIT_FLAG  %d\n", prefs.getInt("INIT_FLAG"));
-  prefs.end();
+  settings.print();
 }
 
 /**
- * Initialize preferences including INIT_FLAG
+ * Register the keys of the namespace "SETTINGS" with their defaults
+ * and load them once. The schema version replaces the former INIT_FLAG
+ * 1947: STATION and VOLUME keep their stored values, INIT_FLAG is dropped.
  */
 void initPrefs()
 {
-  prefs.begin("SETTINGS");
-  
-  if (prefs.getInt("INIT_FLAG", 0) != 1947)
-  { 
-    prefs.clear();
-    prefs.putInt("STATION", 0);
-    prefs.putFloat("VOLUME", 0.33);
-    prefs.putInt("INIT_FLAG", 1947);
-  }
-  else
-  { 
-    currentStation = prefs.getInt("STATION");
-    currentVolume =  prefs.getFloat("VOLUME");
-  }
-  prefs.end();
+  settings.addInt("STATION", 0);
+  settings.addFloat("VOLUME", 0.33f);
+  settings.addInt("BACKLIGHT", 0);  // selected LED of panel 4
+  settings.begin();
   log_n("==> done");
-}
\ No newline at end of file
+}
@@ -1,8 +1,16 @@
 #include <Arduino.h>
 #include <WiFi.h>
+#include <esp_sntp.h>
+#include <atomic>
+#include "TimeSync.h"
+
+// A local NTP server for tests can be set with the build flag -DNTP_SERVER=\"192.168.1.10\"
+#ifndef NTP_SERVER
+#define NTP_SERVER "ch.pool.ntp.org"
+#endif
 
 // https://www.gnu.org/software/libc/manual/html_node/TZ-Variable.html
-const char *NTP_SERVER_POOL = "ch.pool.ntp.org";  // used when dns is available
+const char *NTP_SERVER_POOL = NTP_SERVER;         // used when dns is available
 const char *time_a_g_nist_gov = "129.6.15.28";    // fallback ip when dns is not available
 const char *MEZ_MESZ = "MEZ-1MESZ-2,M3.5.0/02:00:00,M10.5.0/03:00:00"; // Mitteleuropäische Zeit / Sommerzeit
 const char *EST_EDT  = "EST5EDT4,M3.2.0/02:00:00,M11.1.0/02:00:00";    // Eastern standard time / dayligt saving time
@@ -14,24 +22,89 @@ const char TZ_BERLIN[]    = "CET-1CEST,M3.5.0,M10.5.0/3";
 const char TZ_LISBON[]    = "WET0WEST,M3.5.0/1,M10.5.0";
 const char TZ_NEWYORK[]   = "EST5EDT4,M3.2.0/02:00:00,M11.1.0/02:00:00";
 
+// The last known time survives a soft reboot in RTC memory, not a power cycle
+struct RtcState
+{
+  uint32_t magic;
+  time_t   epoch;
+};
+RTC_NOINIT_ATTR static RtcState rtcState;
+static const uint32_t RTC_MAGIC = 0x4e545031;        // "NTP1", rtcState is valid
+static const time_t   VALID_EPOCH = 1700000000;      // earlier times are not set
+static const uint32_t MS_SYNC_MAX_AGE = 2*3600*1000; // SNTP syncs every hour
+
+static std::atomic<bool>     isSynced{false};  // set by the SNTP callback
+static std::atomic<uint32_t> msLastSync{0};
+static bool isRestored = false;
+
+
+// Called by SNTP in the lwIP task when the time has been set
+static void onTimeSync(struct timeval *tv)
+{
+  rtcState.epoch = tv->tv_sec;
+  rtcState.magic = RTC_MAGIC;
+  msLastSync = millis();
+  isSynced = true;
+}
+
+
 /**
- * Initialize the ESP32 RTC with local time
- * and close the no longer needed WiFi connection
- * when disconnect is passed as true, default is false
-*/
-void initRTC(const char *timeZone, bool disconnect = false)
+ * Sets the time zone and restores the last known time after a soft
+ * reboot, if the system time has not survived it. Needs no network,
+ * so the clock runs from boot on.
+ */
+void restoreRTC(const char *timeZone)
 {
-  tm rtcTime;
-  configTzTime(timeZone, NTP_SERVER_POOL, time_a_g_nist_gov);
-  while(! getLocalTime(&rtcTime))
+  setenv("TZ", timeZone, 1);
+  tzset();
+  if (time(nullptr) >= VALID_EPOCH)
   {
-    Serial.println("...Failed to obtain time");
-    vTaskDelay(2000);
-    ESP.restart();
+    isRestored = true;
   }
-  log_i("Got time from NTP Server");
-  if (disconnect) WiFi.disconnect(true); //rtc is set, wifi connection no longer needed
-  log_i("==> done");
+  else if (rtcState.magic == RTC_MAGIC && rtcState.epoch >= VALID_EPOCH)
+  {
+    timeval tv = { rtcState.epoch, 0 };
+    settimeofday(&tv, nullptr);
+    isRestored = true;
+  }
+  log_i("==> %s", isRestored ? "time restored" : "time unknown");
+}
+
+
+/**
+ * Starts the synchronization of the ESP32 RTC with the NTP server
+ * in the background and returns at once. Call it when the WLAN is
+ * connected. The time is set by SNTP when the server answers and 
+ * then every hour.
+*/
+void initRTC(const char *timeZone, const char *ntpServer = NTP_SERVER_POOL)
+{
+  sntp_set_time_sync_notification_cb(onTimeSync);
+  configTzTime(timeZone, ntpServer, time_a_g_nist_gov);
+  log_i("==> synchronizing with %s", ntpServer);
+}
+
+
+/**
+ * Keeps the current time in RTC memory for a soft reboot,
+ * call it every second
+ */
+void saveRTC()
+{
+  time_t now = time(nullptr);
+  if (now < VALID_EPOCH) return;
+  rtcState.epoch = now;
+  rtcState.magic = RTC_MAGIC;
+}
+
+
+/**
+ * Returns the quality of the system time
+ */
+TimeSync timeSync()
+{
+  if (isSynced) return (millis() - msLastSync < MS_SYNC_MAX_AGE) ? TimeSync::SYNCED : TimeSync::STALE;
+  return isRestored ? TimeSync::RESTORED : TimeSync::NONE;
 }
 
 /**
@@ -43,7 +116,7 @@ void printDateTime(int format)
   char buf[40];
   int  bufSize = sizeof(buf);
 
-  getLocalTime(&rtcTime);
+  if (! getLocalTime(&rtcTime, 0)) return;  // time unknown
   switch (format)
   {
     case 0:  
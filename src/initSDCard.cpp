@@ -1,31 +1,37 @@
 #include <Arduino.h>
 #include <SD.h>
+#include "SpiBus.h"
 
+// SPI clock of the SD card, e.g. -DSD_FREQUENCY=40000000. 
+// If the card does not start, the clock is halved down to 4 MHz.
+#ifndef SD_FREQUENCY
+#define SD_FREQUENCY 20000000
+#endif
 
 /**
- * Initialize the SD card (Trans Flash) using VSPI (SPI3_HOST) or HSPI_HOST (SPI2_HOST)
- * The pins SCK = 18, MISO = 19, MOSI = 23 and CS = 5 are wired onboard
+ * Initialize the SD card (Trans Flash) on its own SPI bus VSPI (SPI3_HOST).
+ * The pins SCK = 18, MISO = 19, MOSI = 23 and CS = 5 are wired onboard.
  * Define 
- * SPIClass sdcardSPI(HSPI);
- * or
- * SPIClass sdcardSPI(VSPI);
- * in main.cpp 
- * and pass sdcardSPI as argument to initSDcard()
+ * SpiBus sdBus(VSPI, TF_SCLK, TF_MISO, TF_MOSI);
+ * in main.cpp and pass sdBus as argument to initSDcard().
+ * The card is started with the highest clock it accepts, 
+ * at most SD_FREQUENCY. Returns false if no card is found.
 */
-void initSDCard(SPIClass &spi)
+bool initSDCard(SpiBus &bus)
 {
-  // Use custom SPI class
-  spi.begin(TF_SCLK, TF_MISO, TF_MOSI, TF_CS);
-  if (!SD.begin(TF_CS, spi)) // 👉 Use default frequency of 4MHz
-      log_e("==> SD.begin failed!");
-  else
-      log_e("==> done");
-
-    // Use default VSPI with pins 5, 18, 19, 23 (CS, SCLK, MISO, MOSI)
-/*     if (!SD.begin()) // 👉 Use default frequency of 4MHz
-        log_e("==> SD.begin failed!");
-    else
-        log_e("==> done"); */
+  bus.begin();
+  SpiLock lock(bus);
+  for (uint32_t f = SD_FREQUENCY; f >= 4000000; f /= 2)
+  {
+    if (SD.begin(TF_CS, bus.spi(), f))
+    {
+      log_i("==> done, %lu MHz", f / 1000000);
+      return true;
+    }
+    SD.end();
+  }
+  log_e("==> SD.begin failed!");
+  return false;
 }
 
 
@@ -53,38 +59,3 @@ free   %6llu MB
 )", knownCardTypes[cardType], cardSize, cardTotal, cardUsed, cardFree);
   Serial.printf("\n");  
 }
-
-
-/**
- * Recursively lists all directories/files of 
- * the file system starting at direcory dir
- * 
- * Usage    listFiles(SD.open("/"));            // show content starting at root
- *          listFiles(SD.open("/SCREENSHOTS"))  // show content of directory SCREENSHOTS
- * 
- * Code borrowed from:
- * https://wiki-content.arduino.cc/en/Tutorial/LibraryExamples/Listfiles * 
-*/
-void listFiles(File dir, int indent=0) 
-{
-  while (true) 
-  {
-    File entry =  dir.openNextFile();
-
-    if (! entry) break; // no more files
-    
-    Serial.printf("%*c", indent*4, ' ');
-
-    if (entry.isDirectory()) 
-    {
-      Serial.printf("%s/\n", entry.name());
-      listFiles(entry, indent + 1);
-    } 
-    else 
-    {
-      // files have sizes, directories do not
-      Serial.printf("%s, %d\n", entry.name(), entry.size());
-    }
-    entry.close();
-  }
-}
\ No newline at end of file
@@ -6,21 +6,27 @@
  * Purpose      Shows how to implement some graphical user interface components
  *                  UiPanel   the container for the gui components
  *                  UiButton  with a value field on the button and a label to the right. It is
- *                            the base class of UiLed and UiSlider 
+ *                            the base class of UiLed, UiSlider, UiBar and UiArcMeter
  *                  UiLed     on/off toggle
  *                  UiHslider a horizontal slider that sweeps over a certain range of values
- *                  UiKeypad  a numeric keypad to enter numeric values
+ *                  UiVslider a vertical slider
+ *                  UiBar     a bar graph showing a level, e.g. of the LDR
+ *                  UiArcMeter an arc meter showing a level and its value
+ *                  UiChart   a scrolling time-series chart, e.g. of the LDR value
+ *                  UiKeypad  a numeric keypad to enter numeric values. Other key layouts
+ *                            are UiKeypadT<UiKeys::Float>, <UiKeys::Hex> and <UiKeys::Pin>
  * 
  * Board        ESP32-2432S028 with touchscreen and SD card from AITEXM ROBOT
  *              https://www.aliexpress.com/item/1005005616073472.html?gps-id=pcStoreJustForYou&scm=1007.23125.137358.0&scm_id=1007.23125.137358.0&scm-url=1007.23125.137358.0&pvid=629012e6-491d-40f0-b41b-033335bc0c49&_t=gps-id:pcStoreJustForYou,scm-url:1007.23125.137358.0,pvid:629012e6-491d-40f0-b41b-033335bc0c49,tpp_buckets:668%232846%238114%231999&pdp_npi=4%40dis%21CHF%2110.65%218.62%21%21%2112.03%219.74%21%40210324bf17060488843367930ea758%2112000033759549673%21rec%21CH%21767770434%21&spm=a2g0o.store_pc_home.smartJustForYou_2007716161329.1005005616073472
  * 
- * Remarks      👉 For some inexplicable reason, no screenshot can be saved 
- *                 to the SD card when the touchscreen is active. 
+ * Remarks      The touchpad used to share VSPI with the SD card, then no
+ *              screenshot could be saved while the touchscreen was active.
+ *              It now uses software SPI, the SD card owns VSPI (see SpiBus).
  * 
  * SPI pins                    SPI_HOST        SPIClass  MISO   MOSI   SCLK  CS  IRQ   Type
  *              LCD       SPI2_HOST=HSPI_HOST    HSPI     12     13     14   15   -    ILI9341  
  *              SD Card   SPI3_HOST=VSPI_HOST    VSPI     19     23     18    5   -    ENC28J60 
- *              Touchpad  SPI3_HOST=VSPI_HOST    VSPI     39     32     25   33   36   XPT2046
+ *              Touchpad  software SPI             -      39     32     25   33   36   XPT2046
  * 
  * References   https://github.com/lovyan03/LovyanGFX                      (graphic library)
  *              https://github.com/rzeldent/platformio-espressif32-sunton/ (board definitions)
@@ -32,41 +38,74 @@
 #pragma GCC optimize ("Ofast")
 #include <Arduino.h>
 #include <SD.h>
-#include <Preferences.h>
 #include <ESPAsyncWebServer.h>
 #include "ESP32AutoConnect.h"
 #include "lgfx_ESP32_2432S028.h"
 #include "UiComponents.h"
+#include "AdcSampler.h"
+#include "Backlight.h"
+#include "LocalClock.h"
 #include "PulseGen.h"
+#include "RemoteApi.h"
+#include "DataLogger.h"
+#include "FileServer.h"
+#include "SdIndex.h"
+#include "SdWriter.h"
+#include "Settings.h"
+#include "SpiBus.h"
+#include "UiQueue.h"
+#include "TimeSync.h"
 #include "Wait.h"
 
 using Action = void(&)(LGFX &lcd);
 enum class ROTATION { LANDSCAPE_USB_RIGHT, PORTRAIT_USB_UP, 
                       LANDSCAPE_USB_LEFT,  PORTRAIT_USB_DOWN };
 const char hostname[] = "cyd-gui";
+const uint16_t SETTINGS_VERSION = 2;  // version 1 was the INIT_FLAG 1947
 AsyncWebServer server(80);
-Preferences prefs;
+Settings settings("SETTINGS", SETTINGS_VERSION);  // loaded once, committed debounced
+ESP32AutoConnect wifi(server, hostname);
 LGFX lcd;
+AdcSampler adcSampler;
+int ldrChannel = -1;
+Backlight backlight;
+LocalClock localClock;
+UiQueue uiQueue;  // widget changes from other tasks
+RemoteApi remoteApi(server, uiQueue);
 GFXfont myFont = fonts::DejaVu18;
-//SPIClass sdcardSPI(VSPI); // uncomment this line to take screenshots
+SpiBus sdBus(VSPI, TF_SCLK, TF_MISO, TF_MOSI);  // the SD card owns VSPI
+SdWriter sdWriter(sdBus);                       // buffered writes, e.g. screenshots
+DataLogger logger(sdBus);                       // binary log in /LOG
+SdIndex sdIndex(sdBus);                         // index of the files on the card
+FileServer fileServer(sdBus, lcd);              // files and screenshots over HTTP
+
+// Sources of the log records, the event tells the meaning of the value
+enum LogSource : uint8_t 
+{ 
+    LOG_LDR,        // event 0, value = filtered LDR reading
+    LOG_BACKLIGHT,  // event = selected LED, value = brightness or 0 for auto
+    LOG_WIFI        // event = WiFiState, value = connection attempts
+};
 
 extern void nop(LGFX &lcd);
 extern void initDisplay(LGFX &lcd, uint8_t rotation=0, lgfx::v1::GFXfont *theFont=&myFont, Action greet=nop);
-extern void initESP32AutoConnect(AsyncWebServer &webServer, Preferences &prefs, const char hostname[]);
+extern void initESP32AutoConnect(ESP32AutoConnect &ac, WiFiStateCallback onStateChange);
 extern void initPrefs();
-extern void initRTC(const char *timeZone, bool disconnect = false);
-extern void initSDCard(SPIClass &spi);
+extern void initRTC(const char *timeZone, const char *ntpServer);
+extern bool initSDCard(SpiBus &bus);
 extern bool getMappedTouch(LGFX &lcd, int &x, int &y);
-extern void listFiles(File dir, int indent=0);
 extern void printConnectionDetails();
 extern void printDateTime(int format);
-extern void printNearbyNetworks();
+extern void restoreRTC(const char *timeZone);
+extern void saveRTC();
+extern TimeSync timeSync();
 extern void printSDCardInfo();
 extern void printPrefs();
-extern bool saveBmpToSD_16bit(LGFX &lcd, const char *filename);
-extern bool saveBmpToSD_24bit(LGFX &lcd, const char *filename);
+extern bool saveBmpToSD_16bit(LGFX &lcd, SdWriter &file, const char *filename);
+extern bool saveBmpToSD_24bit(LGFX &lcd, SdWriter &file, const char *filename);
 
 extern const char *MEZ_MESZ;
+extern const char *NTP_SERVER_POOL;
 
 
 /**
@@ -76,257 +115,400 @@ extern const char *MEZ_MESZ;
  * Values can also be entered directly in the value field using a
  * displayed keypad. The keypad appears when the value field is tapped.
  * The entered value is limited to the specified value range.
+ * 
+ * The panels are created hidden with static storage. Their bounds
+ * are set with setBounds() in setup() before they are shown.
 */
 class UiPanel1 : public UiPanel
 {
     public:
-        UiPanel1(LGFX &lcd, int x, int y, int w, int h, int bgColor, bool hidden=true) : 
-            UiPanel(lcd, x, y, w, h, bgColor, hidden)
+        UiPanel1(LGFX &lcd, int bgColor) : 
+            UiPanel(lcd, UiRect(), bgColor, true)
         {
-            _sliderA->addValueField(_valueField);
+            _sliderA.addValueField(&_valueField);
 
-            _sliderA->setRange(-3.3, 6.60);    // Set a double value range
-            _sliderA->slideToValue(1.078000);  // Set initial value. Trailing zeros are truncated.
+            _sliderA.setRange(-3.3, 6.60);    // Set a double value range
+            _sliderA.slideToValue(1.078000);  // Set initial value. Trailing zeros are truncated.
 
-            //_sliderA->setRange(0, 255);   // Set an integer value range
-            //_sliderA->slideToValue(128);  // Set initial value
+            //_sliderA.setRange(0, 255);   // Set an integer value range
+            //_sliderA.slideToValue(128);  // Set initial value
 
-            if (! _hidden) { show(); }
+            //_sliderA.setRange(-3.3, 6.60, 3);  // Set a fixed-point value range with 3 decimals
+            //_sliderA.slideToValue(1.078);      // Set initial value, shown as 1.078
         }
 
         void handleKeys(int x, int y);
+        void addRemote(RemoteApi &api);
+
+        // Rows: text, value field, slider
+        void layout()
+        {
+            _layout.update(getBounds());
+            _valueField.place(_layout.cell(1).leftCentered(95, 25));
+            _sliderA.place(_layout.cell(2).leftCentered(min(200, _layout.cell(2).w - 30), 12));
+        }
 
         void show()
         {
             UiPanel::show();
             panelText(10, 10, "Slider with assigned value field, which", TFT_WHITE, fonts::DejaVu9);
             panelText(10, 25, "is also used for input with the keypad", TFT_WHITE, fonts::DejaVu9);
-            for (int i = 0; i < _btns.size(); i++)
+            for (UiButton *btn : _btns)
             {
-                _btns.at(i)->draw();
+                btn->draw();
             }
         };
 
         
     private:
-        UiButton *_valueField = new UiButton(this, _x+10,_y+40,95,25, "", "slider value");
-        UiHslider *_sliderA   = new UiHslider(this, _x+10, _y+75, 200, 12, TFT_CYAN, "A");
-        std::vector<UiButton *> _btns = {_valueField, _sliderA};
+        static constexpr uint8_t _weights[] = {4, 3, 3};
+        UiLayout  _layout     = UiLayout(UiFlow::COLUMN, 3, 1, 10, 0, _weights);
+        UiButton  _valueField = UiButton(this, 10, 40, 95, 25, "", "slider value");
+        UiHslider _sliderA    = UiHslider(this, 10, 75, 200, 12, TFT_CYAN, "A");
+        UiButton *const _btns[2] = {&_valueField, &_sliderA};
 };
 
 
 /**
  * Panel 2 holds different buttons. 3 round LED buttons
- * and 2 rectangular buttons to switch off and on the LEDs
+ * and 2 rectangular buttons to switch off and on the LEDs.
+ * A chart in the free grid cell plots the LDR value. Tapping the
+ * chart switches between the latest samples and the envelopes of 
+ * the last 1, 6 and 22 hours kept in a min/max pyramid.
 */
 class UiPanel2 : public UiPanel
 {
     public:
-        UiPanel2(LGFX &lcd, int x, int y, int w, int h, int bgColor, bool hidden=true) : 
-            UiPanel(lcd, x, y, w, h, bgColor, hidden)
+        UiPanel2(LGFX &lcd, int bgColor) : 
+            UiPanel(lcd, UiRect(), bgColor, true)
         {
-            if (! _hidden) show();
+            _ldrChart.setRange(0, 4095);
+            _ldrChart.setHistory(&_ldrHistory);
+        }
+
+        // Grid of 3 rows: LED and button side by side
+        void layout()
+        {
+            _layout.update(getBounds());
+            _led1.place(_layout.cell(0).inset(5, 0));
+            _btnOn.place(_layout.cell(1).centered(50, 24));
+            _led2.place(_layout.cell(2).inset(5, 0));
+            _btnOff.place(_layout.cell(3).centered(50, 24));
+            _led3.place(_layout.cell(4).inset(5, 0));
+            _ldrChart.place(_layout.cell(5).inset(5, 2));
         }
 
         void show()
         {
             UiPanel::show();
-            for (int i = 0; i < _btns.size(); i++)
+            for (UiButton *btn : _btns)
             {
-                _btns.at(i)->draw();
+                btn->draw();
             }
         };
 
         void    handleKeys(int x, int y);
-        UiButton *getButton(uint8_t i);
+        void    addRemote(RemoteApi &api);
+        void    plotLdr(int value) { _ldrChart.addSample(value); }
 
     private:
-        UiButton  *_btnOn  = new UiButton(this, _x+180,_y+20,50,24, blueTheme, "On");
-        UiButton  *_btnOff = new UiButton(this, _x+180,_y+60,50,24, blueTheme, "Off");
-        UiLed     *_led1   = new UiLed(this, _x+20, _y+15, 10, TFT_RED, "Heating", true); // preselect led1
-        UiLed     *_led2   = new UiLed(this, _x+20, _y+50, 10, TFT_YELLOW, "Fan", true);  // preselect led2
-        UiLed     *_led3   = new UiLed(this, _x+20, _y+85, 10, TFT_BLUE, "Water", false); // initially off
+        UiLayout  _layout = UiLayout(UiFlow::GRID, 6, 2, 5);
+        UiButton  _btnOn  = UiButton(this, 180, 20, 50, 24, blueTheme, "On");
+        UiButton  _btnOff = UiButton(this, 180, 60, 50, 24, blueTheme, "Off");
+        UiLed     _led1   = UiLed(this, 20, 15, 10, TFT_RED, "Heating", true); // preselect led1
+        UiLed     _led2   = UiLed(this, 20, 50, 10, TFT_YELLOW, "Fan", true);  // preselect led2
+        UiLed     _led3   = UiLed(this, 20, 85, 10, TFT_BLUE, "Water", false); // initially off
+        UiChart   _ldrChart = UiChart(this, 130, 80, 100, 20, TFT_YELLOW, blueTheme);
+        UiMinMaxPyramid _ldrHistory;
         
-        std::vector<UiButton *> _btns = { _btnOn, _led1, _led2, _led3, _btnOff };    
+        UiButton *const _btns[6] = { &_btnOn, &_led1, &_led2, &_led3, &_btnOff, &_ldrChart };    
 };
 
 
 /**
  * Panel 3 contains 2 value fields to display time and date from an
- * NTP server. A third value field shows the adc-value read from the
- * built-in photoresistor. No keyhandler is required for this panel.
- * The time is updated every second using the Wait class.
+ * NTP server. A third value field shows the filtered adc-value of the
+ * built-in photoresistor, which the AdcSampler task publishes. 
+ * No keyhandler is required for this panel.
+ * The local clock is updated every second using the Wait class and
+ * reports which fields of time and date have changed.
 */
 class UiPanel3 : public UiPanel
 {
     public:
-        UiPanel3(LGFX &lcd, int x, int y, int w, int h, int bgColor, bool hidden=true) : 
-            UiPanel(lcd, x, y, w, h, bgColor, hidden)
+        UiPanel3(LGFX &lcd, int bgColor) : 
+            UiPanel(lcd, UiRect(), bgColor, true)
         {
-            if (! _hidden) show();
+            _ldrBar.setRange(0, 4095);
+        }
+
+        // Rows: title with sync LED, time, date, LDR value
+        void layout()
+        {
+            _layout.update(getBounds());
+            _syncLed.place(_layout.cell(0).inset(10, 0));  // in front of the title
+            _theTime.place(_layout.cell(1).centered(94, 24));
+            _theDate.place(_layout.cell(2).centered(122, 24));
+            UiRect ldr = _layout.cell(3).inset(6, 0);
+            _cdsLdr.place(ldr.leftCentered(50, 20));
+            _ldrBar.place({ldr.x + 58, ldr.y + (ldr.h - 10)/2, ldr.w - 58, 10});
         }
 
         void show()
         {
             UiPanel::show();
             panelText(30, 10, "Internet Time", TFT_WHITE, fonts::DejaVu9);
-            for (int i = 0; i < _btns.size(); i++)
+            for (UiButton *btn : _btns)
             {
-                _btns.at(i)->draw();
+                btn->draw();
             }
         };
 
-      void updateDateTime();
-      void updateCdsLdr();
+      void updateDateTime(const LocalClock &clock, uint8_t changed);
+      void showTimeSync(TimeSync sync);
+      void showStatus(const char *text);
+      int  updateCdsLdr();
+      void addRemote(RemoteApi &api);
 
     private:
-        UiButton *_theTime = new UiButton(this, _x+25, _y+18,  94, 24, "");
-        UiButton *_theDate = new UiButton(this, _x+10, _y+48, 122, 24, "");
-        UiButton *_cdsLdr  = new UiButton(this, _x+10, _y+80,  50, 20, blueTheme, "", "LDR value");
+        static constexpr uint8_t _weights[] = {1, 3, 3, 3};
+        UiLayout _layout  = UiLayout(UiFlow::COLUMN, 4, 1, 4, 0, _weights);
+        UiButton _theTime = UiButton(this, 25, 18,  94, 24, "");
+        UiButton _theDate = UiButton(this, 10, 48, 122, 24, "");
+        UiButton _cdsLdr  = UiButton(this, 10, 80,  50, 20, blueTheme, "", "");
+        UiBar    _ldrBar  = UiBar(this, 68, 85, 70, 10, TFT_YELLOW, blueTheme);
+        UiLed    _syncLed = UiLed(this, 10, 30, 4, TFT_RED, blueTheme);  // quality of the time
+        TimeSync _sync    = TimeSync::NONE;
+        static constexpr uint32_t MS_STATUS = 5000;  // a status covers the date this long
+        bool     _isStatusShown = false;
+        uint32_t _msStatus = 0;
         
-        std::vector<UiButton *> _btns = { _theTime, _theDate, _cdsLdr };    
+        UiButton *const _btns[5] = { &_theTime, &_theDate, &_cdsLdr, &_ldrBar, &_syncLed };    
 };
 
 
 /**
  * Panel 4 contains 4 LED buttons that behave like radiobuttons. 
- * They change the brightness of the display in 4 steps.
+ * They select the mode of the backlight: automatic, following the 
+ * ambient light measured by the LDR, or one of 3 fixed brightnesses.
 */
 class UiPanel4 : public UiPanel
 {
     public:
-        UiPanel4(LGFX &lcd, int x, int y, int w, int h, int bgColor, bool hidden=true) : 
-        UiPanel(lcd, x, y, w, h, bgColor, hidden)
+        UiPanel4(LGFX &lcd, int bgColor) : 
+            UiPanel(lcd, UiRect(), bgColor, true)
+        {}
+
+        // Rows: title and one row per radiobutton
+        void layout()
         {
-            if (! _hidden) show();
+            _layout.update(getBounds());
+            for (int i = 0; i < 4; i++)
+            {
+                _btns[i]->place(_layout.cell(i+1).inset(8, 0));
+            }
         }
 
         void show()
         {
             UiPanel::show();
-            panelText(10, 10, "Radiobuttons", TFT_WHITE, fonts::DejaVu9);
-            for (int i = 0; i < _btns.size(); i++)
+            panelText(10, 10, "Backlight", TFT_WHITE, fonts::DejaVu9);
+            for (UiLed *btn : _btns)
             {
-                _btns.at(i)->draw();
+                btn->draw();
             }
         }
         void handleKeys(int x, int y);
+        void select(int i);
 
     private:
-        UiLed     *_led1   = new UiLed(this, _x+15, _y+30, 7, TFT_RED,    blueTheme, "****", true); // preselect led1
-        UiLed     *_led2   = new UiLed(this, _x+15, _y+50, 7, TFT_GREEN,  blueTheme, "***");
-        UiLed     *_led3   = new UiLed(this, _x+15, _y+70, 7, TFT_BLUE,   blueTheme, "**");
-        UiLed     *_led4   = new UiLed(this, _x+15, _y+90, 7, TFT_YELLOW, blueTheme, "*");
+        UiLayout _layout = UiLayout(UiFlow::COLUMN, 5);
+        UiLed    _led1   = UiLed(this, 15, 30, 7, TFT_RED,    blueTheme, "Auto", true); // preselect auto
+        UiLed    _led2   = UiLed(this, 15, 50, 7, TFT_GREEN,  blueTheme, "***");
+        UiLed    _led3   = UiLed(this, 15, 70, 7, TFT_BLUE,   blueTheme, "**");
+        UiLed    _led4   = UiLed(this, 15, 90, 7, TFT_YELLOW, blueTheme, "*");
 
-        std::vector<UiButton *> _btns = { _led1, _led2, _led3, _led4 };                
+        UiLed *const _btns[4] = { &_led1, &_led2, &_led3, &_led4 };                
 };
 
-// Declare pointers to the panels and initialize them with nullptr
-UiPanel1  *panel1 = nullptr; 
-UiPanel2  *panel2 = nullptr; 
-UiPanel3  *panel3 = nullptr;
-UiPanel4  *panel4 = nullptr;
+// The whole user interface has static storage. Its RAM cost is 
+// known at link time (see the .bss section in the map file).
+UiPanel1 panel1(lcd, TFT_OLIVE); 
+UiPanel2 panel2(lcd, TFT_GREEN); 
+UiPanel3 panel3(lcd, TFT_SKYBLUE);
+UiPanel4 panel4(lcd, TFT_ORANGE);
 
-// Declare the static class variable again in main
-std::vector<UiPanel *> UiPanel::panels;
+// All panels, redrawn when the keypad is closed
+UiPanel *const panels[] = { &panel1, &panel2, &panel3, &panel4 };
 
 // Create they keypad hidden
 UiKeypad keypad(lcd, 20,80, TFT_GOLD, true);    
 
+// The screen is divided into 3 rows, the bottom row into 2 columns.
+// The cells are recomputed only when the screen is rotated.
+const uint8_t bottomWeights[] = { 145, 95 };
+UiLayout screenLayout(UiFlow::COLUMN, 3);
+UiLayout bottomLayout(UiFlow::ROW, 2, 1, 0, 0, bottomWeights);
+
 Wait waitUserInput(100);  // look for user input every 100 ms
 Wait waitDateTime(1000);  // Get time and date every second
 Wait waitCdsLdr(2500);    // Read CDS LDR all 2.5 seconds
+Wait waitBacklight(50);   // Adjust the backlight every 50 ms
+Wait waitLogFlush(60000); // Write the buffered log records every minute
 
 
 /**
  * Keyhandler for Panel 1. 
- * If the tapped coordinates x,y correspond to a button, the associated 
- * function is executed. 
+ * The row hit by the tapped coordinates x,y is looked up in the layout
+ * of the panel. If the tap lies on the component of that row, the
+ * associated function is executed. 
  *  - If the value field of the slider is tapped, the value field is 
  *    registered with the keypad and this is then displayed.
  *  - If the slider is tapped or moved, the corresponding value is 
  *    displayed in the value field.
- * The order of the buttons, i.e. value field and slider,  is determined by
- * their definition in the std::vector<UiButtons *> of the associated panel. 
 */
 void UiPanel1::handleKeys(int x, int y)
 {
-    for (int i = 0; i < _btns.size(); i++)
+    switch(_layout.hitTest(x, y))
     {
-        if (_btns.at(i)->touched(x, y)) 
-        {
-            switch(i)
+        case 1: // The value field of the slider has been tapped
+            if (_valueField.touched(x, y))
             {
-                case 0: // The value field of the slider has been tapped
-                    _pKeypad->addValueField(_btns.at(i)); // Register the value field with the keypad
-                    _pKeypad->show(); // show keypad 
-                break;
-
-                case 1: // The slider has been tapped
-                    _sliderA->slideToPosition(x);
-                break;
+                _pKeypad->addValueField(&_valueField); // Register the value field with the keypad
+                _pKeypad->show(); // show keypad 
             }
-        }
+        break;
+
+        case 2: // The slider has been tapped
+            if (_sliderA.touched(x, y)) _sliderA.slideToPosition(x);
+        break;
     }
 }
 
 
+/**
+ * Registers the slider and its value field with the remote API.
+ * Written values are limited to the range like entered ones.
+*/
+void UiPanel1::addRemote(RemoteApi &api)
+{
+    api.addSlider("sliderA", &_sliderA);
+    api.addField("valueA", &_valueField, true);
+}
+
+
 /**
  * Keyhandler for Panel 2
- * If the tapped coordinates x,y correspond to a button, the associated 
- * function is executed.
+ * The cell hit by the tapped coordinates x,y is looked up in the 
+ * layout of the panel and the associated function is executed.
  *  - The 3 LED buttons only change their status, which is indicated by a color change.
  *  - The 2 buttons on and off switch all LEDs on or off.
- * The order of the buttons is determined by their definition in 
- * the std::vector<UiButtons *> of the associated panel.
+ *  - The chart steps through its windows, live and the last 1, 6 and 22 hours 
+ *    of LDR samples taken every 2.5 s.
+ * The cells are numbered row by row, LEDs on the left, buttons on the right.
 */
 void UiPanel2::handleKeys(int x, int y)
 {
-    for (int i = 0; i < _btns.size(); i++)
+    switch(_layout.hitTest(x, y))
     {
-        if (_btns.at(i)->touched(x, y)) 
-        {
-            switch(i)
-            {
-                case 0: // _btnOn
-                  _led1->on(); _led2->on(); _led3->on();
-                break;
+        case 0: // _led1
+            _led1.toggle();
+        break;
 
-                case 1: // _led1
-                  _led1->toggle();
-                break;
+        case 1: // _btnOn
+            _led1.on(); _led2.on(); _led3.on();
+        break;
 
-                case 2: // _led2
-                   _led2->toggle();
-                break;
+        case 2: // _led2
+            _led2.toggle();
+        break;
 
-                case 3: // _led3
-                   _led3->toggle();
-                break;
+        case 3: // _btnOff
+            _led1.off(); _led2.off(); _led3.off();
+        break;
 
-                case 4: // _btnOff
-                   _led1->off(); _led2->off(); _led3->off();
-                break;
-            }
-            delay(300);
-        }      
+        case 4: // _led3
+            _led3.toggle();
+        break;
+
+        case 5: // _ldrChart
+        {
+            static const uint32_t windows[] = {0, 1440, 8640, UiMinMaxPyramid::SIZE << (UiMinMaxPyramid::LEVELS-1)};
+            static uint8_t w = 0;
+            w = (w + 1) % (sizeof(windows) / sizeof(windows[0]));
+            _ldrChart.setWindow(windows[w]);
+        }
+        break;
+
+        default: // no component hit
+        return;
     }
+    delay(300);
+}
+
+
+/**
+ * Registers the 3 LED buttons with the remote API
+*/
+void UiPanel2::addRemote(RemoteApi &api)
+{
+    api.addLed("heating", &_led1);
+    api.addLed("fan", &_led2);
+    api.addLed("water", &_led3);
 }
 
 
 /**
  * Action for Panel 3
- * Updates time and date in the corresponding value fields
+ * Updates the fields of time and date that have changed, 
+ * the date is repainted once a day and when a status has expired
 */
-void UiPanel3::updateDateTime()
+void UiPanel3::updateDateTime(const LocalClock &clock, uint8_t changed)
 {
-    tm   rtcTime;
     char buf[12];
-    getLocalTime(&rtcTime);
-    strftime(buf, sizeof(buf), "%T", &rtcTime); // hh:mm:ss
-    _theTime->updateValue(buf);
-    strftime(buf, sizeof(buf), "%F", &rtcTime); // YYYY-MM-DD
-    _theDate->updateValue(buf);
+    if (_isStatusShown && millis() - _msStatus >= MS_STATUS)
+    {
+        _isStatusShown = false;
+        changed |= CLOCK_DATE;
+    }
+    if (changed & CLOCK_SECOND)
+    {
+        clock.formatTime(buf, sizeof(buf)); // hh:mm:ss
+        _theTime.updateValue(buf);
+    }
+    if ((changed & CLOCK_DATE) && ! _isStatusShown)
+    {
+        clock.formatDate(buf, sizeof(buf)); // YYYY-MM-DD
+        _theDate.updateValue(buf);
+    }
+}
+
+
+/**
+ * Action for Panel 3
+ * The LED shows the quality of the time: green synchronized, 
+ * yellow restored or stale, red unknown
+*/
+void UiPanel3::showTimeSync(TimeSync sync)
+{
+    static const int SYNC_COLORS[] = { TFT_RED, TFT_YELLOW, TFT_GREEN, TFT_YELLOW };
+    if (sync == _sync && _syncLed.isOn()) return;
+    _sync = sync;
+    _syncLed.setColor(SYNC_COLORS[static_cast<int>(sync)]);
+    _syncLed.on();
+}
+
+
+/**
+ * Action for Panel 3
+ * Shows the state of the WiFi connection in the date field. Once
+ * the date is known, it is repainted MS_STATUS ms after the last status.
+*/
+void UiPanel3::showStatus(const char *text)
+{
+    _theDate.updateValue(text);
+    _isStatusShown = true;
+    _msStatus = millis();
 }
 
 
@@ -334,50 +516,61 @@ void UiPanel3::updateDateTime()
  * Action for Panel 3
  * Updates the reading from the photo resistor
 */
-void UiPanel3::updateCdsLdr()
+int UiPanel3::updateCdsLdr()
 {
-    uint16_t adc_value = analogRead(CDS_LDR);
-    _cdsLdr->updateValue(adc_value);
+    uint16_t adc_value = adcSampler.value(ldrChannel); // latest filtered value of the sampler task
+    _cdsLdr.updateValue(adc_value);
+    _ldrBar.updateValue(adc_value);  // redraws only the band between old and new level
+    return adc_value;
+}
+
+
+/**
+ * Registers time, date and LDR value read only with the remote API
+*/
+void UiPanel3::addRemote(RemoteApi &api)
+{
+    api.addField("time", &_theTime);
+    api.addField("date", &_theDate);
+    api.addField("ldr", &_cdsLdr);
 }
 
 
 /**
  * Keyhandler for Panel 4
- * If the tapped coordinates x,y correspond to a button, the associated 
- * function is executed.
+ * The row hit by the tapped coordinates x,y is looked up in the layout
+ * of the panel. Row 0 holds the title, rows 1..4 the LED buttons.
  * The 4 LED buttons behave like radiobuttons, only one can be active.
- * They vary the brightness of the display in 4 steps.
-* The order of the buttons is determined by their definition in 
- * the std::vector<UiButtons *> of the associated panel.
+ * The first switches the backlight to automatic control by the LDR,
+ * the others override it with a fixed brightness. The backlight 
+ * moves smoothly to the new brightness.
 */
 void UiPanel4::handleKeys(int x, int y)
 {
-    for (int i = 0; i < _btns.size(); i++)
+    int i = _layout.hitTest(x, y) - 1;
+    if (i < 0) return;
+
+    select(i);
+    settings.putInt("BACKLIGHT", i);  // committed when no key has changed for a while
+}
+
+
+/**
+ * Switches the LED-button i on, the others off, 
+ * and sets the mode of the backlight accordingly
+ */
+void UiPanel4::select(int i)
+{
+    const uint8_t brightness[] = { 0, 255, 96, 32 };
+    if (i < 0 || i > 3) return;
+
+    for (UiLed *led : _btns)  // switch all LED-buttons off
     {
-        if (_btns.at(i)->touched(x, y)) 
-        {
-            for (int b = 0; b < _btns.size(); b++)  // switch all LED-buttons off
-            {
-                reinterpret_cast<UiLed *>(_btns.at(b))->off();
-            }
-            reinterpret_cast<UiLed *>(_btns.at(i))->on();
-            switch(i)
-            {
-                case 0:
-                    _lcd.setBrightness(255);
-                break;
-                case 1:
-                    _lcd.setBrightness(128);
-                break;
-                case 2:
-                    _lcd.setBrightness(64);
-                break;
-                case 3:
-                    _lcd.setBrightness(32);
-                break;
-            }
-        }      
+        led->off();
     }
+    _btns[i]->on();
+    i == 0 ? backlight.setAuto() : backlight.setManual(brightness[i]);
+    logger.log(LOG_BACKLIGHT, i, brightness[i]);
 }
 
 
@@ -407,27 +600,122 @@ void blinkTask(void* arg)
 
 
 /**
- * 👉 An empty white image is created when SD card 
- * and touch are both active. Why are the pixels
- * not output to the file? 
+ * Saves the screen as BMP file to the SD card
 */
 void takeScreenshot()
 {   
     static int count= 0;
     char buf[64];
     snprintf(buf, sizeof(buf), "/SCREENSHOTS/screen%03d.bmp", count++);
-    saveBmpToSD_16bit(lcd, buf);
+    saveBmpToSD_16bit(lcd, sdWriter, buf);
     log_i("Screenshot saved: %s\n", buf);
 }
 
 
+/**
+ * Divides the screen into the panel areas. Returns true
+ * if the screen dimensions have changed since the last call.
+ */
+bool layoutScreen()
+{
+    if (! screenLayout.update({0, 0, lcd.width(), lcd.height()})) return false;
+    bottomLayout.update(screenLayout.cell(2));
+    return true;
+}
+
+
+/**
+ * Moves the panels to the cells of the screen layout
+ * and centers the keypad on the screen
+ */
+void placePanels()
+{
+    panel1.setBounds(screenLayout.cell(0));
+    panel2.setBounds(screenLayout.cell(1));
+    panel3.setBounds(bottomLayout.cell(0));
+    panel4.setBounds(bottomLayout.cell(1));
+    UiRect k = keypad.getBounds();
+    keypad.setBounds(screenLayout.area().centered(k.w, k.h));
+}
+
+
+/**
+ * Rotates the screen, moves the panels and the keypad 
+ * to their new places and redraws them. 
+ */
+void rotateScreen(ROTATION rotation)
+{
+    lcd.setRotation(static_cast<uint8_t>(rotation));
+    if (! layoutScreen()) return;
+    placePanels();
+    lcd.fillScreen(lcd.getBaseColor());
+    UiPanel::redrawPanels();
+    if (! keypad.isHidden()) keypad.show();
+}
+
+
+/**
+ * Called by the autoconnect state machine when the state of the 
+ * WiFi connection changes. The state is shown on panel 3, 
+ * once connected the RTC is synchronized with the NTP server and
+ * the remote API is started.
+ */
+void onWiFiState(WiFiState state)
+{
+    static bool servicesAreStarted = false;
+    char buf[16];
+    logger.log(LOG_WIFI, static_cast<uint8_t>(state), wifi.attempts());
+    switch (state)
+    {
+        case WiFiState::CONNECTING:
+            snprintf(buf, sizeof(buf), "WiFi %d/%d", wifi.attempts(), ESP32AutoConnect::MAX_ATTEMPTS);
+            panel3.showStatus(buf);
+        break;
+
+        case WiFiState::WAITING:
+            panel3.showStatus("WiFi wait");
+        break;
+
+        case WiFiState::PORTAL:
+            panel3.showStatus("WiFi AP");
+        break;
+
+        case WiFiState::CONNECTED:
+            panel3.showStatus("WiFi ok");
+            printConnectionDetails();
+            wifi.networks().refresh();  // printed in the background when done
+            if (! servicesAreStarted)
+            {
+                initRTC(MEZ_MESZ, NTP_SERVER_POOL);  // SNTP syncs in the background from now on
+                sdIndex.serve(server);               // file listing, served with the widgets
+                fileServer.serve(server);
+                remoteApi.begin();
+                servicesAreStarted = true;
+            }
+        break;
+
+        default:
+        break;
+    }
+}
+
+
+/**
+ * Called by the local clock when fields of the time have changed
+ */
+void onClockChange(const LocalClock &clock, uint8_t changed)
+{
+    panel3.updateDateTime(clock, changed);
+}
+
+
 /**
  * Called when OK button of keypad is clicked 
  */
 void handleOkButton(UiButton* btn)
 {
-    String e = btn->getValue();
-    double v = e.toDouble();
+    double v;
+    btn->getValue(v);
     log_i("Keypad OK button clicked, entered value = %5.3f", v);
 }
 
@@ -435,65 +723,104 @@ void setup()
 {
   Serial.begin(115200);
 
+    // The clock runs from boot on, with the time kept across a soft reboot
+    restoreRTC(MEZ_MESZ);
+    printDateTime(5);
+
+    // The settings are read from NVS once, later reads are served from RAM
+    initPrefs();
+    printPrefs();
+
     // Photoconductive cell GT36516 on pin CDS_LDR = 34 varies between 5 .. 300 kOhm
     analogSetAttenuation(ADC_0db);  // Set lowest attenuation for CDS
-    pinMode(CDS_LDR, INPUT);
+    ldrChannel = adcSampler.addChannel(CDS_LDR, 8, 2); // 8 conversions per period, smoothed by 1/4
+    adcSampler.begin(10, 25);       // Sample every 10 ms, publish averages every 250 ms
 
     // Starts the blinking task, which causes the RGB LED to flash 
     // red, green and blue alternately every second
     xTaskCreate(blinkTask, "blinkTask", 1024, NULL, 10, NULL);
-    initESP32AutoConnect(server, prefs, hostname);
-    printConnectionDetails();
-    printNearbyNetworks();
-
-    initRTC(MEZ_MESZ);
-    printDateTime(5);
 
     lcd.setBaseColor(DARKERGREY);
     initDisplay(lcd, static_cast<uint8_t>(ROTATION::PORTRAIT_USB_UP));
   
-    //initSDCard(sdcardSPI);      // Init SD card to take screenshots
-    printSDCardInfo();          // Print SD card details 
-    listFiles(SD.open("/"));    // List the files on SD card 
-
-    // Create the panels and showm them ( argument hidden is set to false)
-    panel1 = new UiPanel1(lcd, 0,                 0, lcd.width(),  lcd.height()/3, TFT_OLIVE,  false);
-    panel2 = new UiPanel2(lcd, 0,     lcd.height()/3, lcd.width(), lcd.height()/3, TFT_GREEN,  false);
-    panel3 = new UiPanel3(lcd, 0,   2*lcd.height()/3, 145,         lcd.height()/3, TFT_SKYBLUE,false);
-    panel4 = new UiPanel4(lcd, 145, 2*lcd.height()/3,  95,         lcd.height()/3, TFT_ORANGE, false);
+    if (initSDCard(sdBus))      // Init SD card, e.g. to take screenshots
+    {
+        sdWriter.begin();
+        logger.begin();         // 32 segments of 1 MB, about 2 months of LDR readings
+        printSDCardInfo();      // Print SD card details 
+        sdIndex.begin();        // Index the files in the background if there is no index yet
+    }
 
-    // Initialize the static class variable with all panels
-    UiPanel::panels = {panel1, panel2, panel3, panel4};
+    // Place the panels in the cells of the screen layout and show them
+    layoutScreen();
+    placePanels();
+    UiPanel::setPanels(panels);
+    UiPanel::redrawPanels();
+    panel4.select(settings.getInt("BACKLIGHT"));  // the backlight mode selected last
 
     // Add a keypad to panel 1
-    panel1->addKeypad(&keypad);
+    panel1.addKeypad(&keypad);
     keypad.addOkCallback(handleOkButton);
 
     lcd.setBrightness(255);
+    localClock.onChange(onClockChange);
+
+    // Widgets that remote dashboards can read and write
+    panel1.addRemote(remoteApi);
+    panel2.addRemote(remoteApi);
+    panel3.addRemote(remoteApi);
     waitDateTime.begin();
 
+    // The UI is usable at once, the WLAN is connected in the background
+    initESP32AutoConnect(wifi, onWiFiState);
+
     log_i("==> done");
 }
 
 
 void loop() 
 {
+    wifi.loop();
+
+    // Widgets changed in this pass are drawn once at its end
+    UiButton::beginFrame();
+    uiQueue.process();  // applies widget changes posted by other tasks
+
     int x, y;
     if (waitUserInput.isOver() && getMappedTouch(lcd, x, y))
     {
         //log_i("Key pressed at %3d, %3d\n", x, y);
-        if (!panel1->isHidden()) panel1->handleKeys(x, y);
-        if (!panel2->isHidden()) panel2->handleKeys(x, y);
-        if (!panel4->isHidden()) panel4->handleKeys(x, y);
+        if (!panel1.isHidden()) panel1.handleKeys(x, y);
+        if (!panel2.isHidden()) panel2.handleKeys(x, y);
+        if (!panel4.isHidden()) panel4.handleKeys(x, y);
         if (!keypad.isHidden())  keypad.handleKeys(x, y);
     }
   
-    if (!panel1->isHidden() && waitCdsLdr.isOver())   panel3->updateCdsLdr();
-    if (!panel3->isHidden() && waitDateTime.isOver()) panel3->updateDateTime();
+    if (!panel1.isHidden() && waitCdsLdr.isOver())
+    {
+        int ldr = panel3.updateCdsLdr();
+        panel2.plotLdr(ldr);
+        logger.log(LOG_LDR, 0, ldr);
+    }
+    if (waitLogFlush.isOver()) logger.flush();
+    settings.loop();    // one NVS commit for all changes, once they have settled
+    if (waitDateTime.isOver())
+    {
+        saveRTC();
+        localClock.update();  // calls onClockChange() when a field has changed
+        panel3.showTimeSync(timeSync());
+    }
+    UiButton::endFrame();
+    fileServer.loop();  // reads the rows of a screenshot being downloaded
+    remoteApi.loop();   // pushes changed values to remote dashboards
+
+    uint8_t brightness;
+    if (waitBacklight.isOver() && backlight.update(adcSampler.value(ldrChannel), brightness))
+    {
+        lcd.setBrightness(brightness);
+    }
 
     // To take automatically screenshots uncomment the following lines
-    // and also line 51 and 453. But when the SD card is activatet, the
-    // touchpad is no longer funtioning.
 /*     delay(2000); takeScreenshot();
     delay(2000); keypad.show();
     delay(2000); takeScreenshot(); 
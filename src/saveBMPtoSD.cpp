@@ -2,13 +2,19 @@
 #include <SD.h>
 #include <LovyanGFX.hpp>
 #include "lgfx_ESP32_2432S028.h"
+#include "SdWriter.h"
 
 
-bool saveBmpToSD_16bit(LGFX &lcd, const char *filename)
+/**
+ * The screenshots are written through an SdWriter. The file is 
+ * preallocated to the size of the bitmap and the rows are 
+ * collected into sector-aligned blocks.
+*/
+bool saveBmpToSD_16bit(LGFX &lcd, SdWriter &file, const char *filename)
 {
   bool result = false;
-  File file = SD.open(filename, "w");
-  if (file)
+  int  size = sizeof(lgfx::bitmap_header_t) + ((2 * lcd.width() + 3) & ~ 3) * lcd.height();
+  if (file.open(filename, size))
   {
     int width  = lcd.width();
     int height = lcd.height();
@@ -35,8 +41,7 @@ bool saveBmpToSD_16bit(LGFX &lcd, const char *filename)
       lcd.readRect(0, y, lcd.width(), 1, (lgfx::rgb565_t*)buffer);
       file.write(buffer, rowSize);
     }
-    file.close();
-    result = true;
+    result = file.close();
   }
   else
   {
@@ -47,11 +52,11 @@ bool saveBmpToSD_16bit(LGFX &lcd, const char *filename)
 }
 
 
-bool saveBmpToSD_24bit(LGFX &lcd, const char *filename)
+bool saveBmpToSD_24bit(LGFX &lcd, SdWriter &file, const char *filename)
 {
   bool result = false;
-  File file = SD.open(filename, "w");
-  if (file)
+  int  size = sizeof(lgfx::bitmap_header_t) + ((3 * lcd.width() + 3) & ~ 3) * lcd.height();
+  if (file.open(filename, size))
   {
     int width  = lcd.width();
     int height = lcd.height();
@@ -78,8 +83,7 @@ bool saveBmpToSD_24bit(LGFX &lcd, const char *filename)
       lcd.readRect(0, y, lcd.width(), 1, (lgfx::rgb888_t*)buffer);
       file.write(buffer, rowSize);
     }
-    file.close();
-    result = true;
+    result = file.close();
   }
   else
   {